@@ -0,0 +1,199 @@
+// Latency and bandwidth of the wrapper against raw MPI, across message sizes.
+// Prints one CSV row per test, path and size:
+//
+//     test,path,bytes,reps,p50_us,p90_us,p99_us,mb_per_s
+//
+// Times are per operation on the slowest rank; ping-pong reports one-way
+// latency (half the round trip).
+//
+// Run with: ./scripts/runBench.sh 4 [max bytes]
+#include "../src/mpiwrapper.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#define MIN_BYTES 1
+#define DEFAULT_MAX_BYTES (64L << 20)
+#define WARMUP 2
+
+/**
+ * @returns How many repetitions to time for a message of the given size,
+ * fewer for larger messages.
+ */
+long reps_for(long bytes) {
+    return std::max(5L, std::min(1000L, (256L << 20) / bytes));
+}
+
+/**
+ * Runs fn reps times after a warmup and returns each repetition's time on
+ * the slowest rank, sorted.
+ */
+std::vector<double> measure(MPIWrapper& mpi, long reps, std::function<void ()> fn) {
+    for (int i = 0; i < WARMUP; i++) {
+        fn();
+    }
+    std::vector<double> times(reps);
+    for (long i = 0; i < reps; i++) {
+        mpi.barrier();
+        double start = MPI_Wtime();
+        fn();
+        times[i] = MPI_Wtime() - start;
+    }
+    times = mpi.allreduceMultiple(times, MPI_MAX);
+    std::sort(times.begin(), times.end());
+    return times;
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+    return sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+}
+
+void report(MPIWrapper& mpi, std::string test, std::string path, long bytes, std::vector<double> times, double scale) {
+    if (mpi.getRank() != 0) {
+        return;
+    }
+    double p50 = percentile(times, 0.50) * scale;
+    printf("%s,%s,%ld,%zu,%.3f,%.3f,%.3f,%.2f\n", test.c_str(), path.c_str(), bytes, times.size(),
+        p50 * 1e6, percentile(times, 0.90) * scale * 1e6, percentile(times, 0.99) * scale * 1e6,
+        bytes / p50 / 1e6);
+    fflush(stdout);
+}
+
+void ping_pong(MPIWrapper& mpi, std::vector<char>& buffer, long bytes) {
+    int rank = mpi.getRank();
+    long reps = reps_for(bytes);
+    MPIView<char> view(buffer.data(), bytes);
+    report(mpi, "pingpong", "wrapper", bytes, measure(mpi, reps, [&]() {
+        if (rank == 0) {
+            mpi.sendMultiple<char>(buffer.data(), bytes, 1);
+            mpi.receiveMultiple<char>(view, 1);
+        } else if (rank == 1) {
+            mpi.receiveMultiple<char>(view, 0);
+            mpi.sendMultiple<char>(buffer.data(), bytes, 0);
+        }
+    }), 0.5);
+    report(mpi, "pingpong", "raw", bytes, measure(mpi, reps, [&]() {
+        if (rank == 0) {
+            MPI_Send(buffer.data(), bytes, MPI_CHAR, 1, 0, MCW);
+            MPI_Recv(buffer.data(), bytes, MPI_CHAR, 1, 0, MCW, MPI_STATUS_IGNORE);
+        } else if (rank == 1) {
+            MPI_Recv(buffer.data(), bytes, MPI_CHAR, 0, 0, MCW, MPI_STATUS_IGNORE);
+            MPI_Send(buffer.data(), bytes, MPI_CHAR, 0, 0, MCW);
+        }
+    }), 0.5);
+}
+
+void ring(MPIWrapper& mpi, std::vector<char>& out, std::vector<char>& in, long bytes) {
+    // Even ranks send first and odd ranks receive first, so large messages
+    // cannot deadlock the ring.
+    bool sendFirst = mpi.getRank() % 2 == 0;
+    long reps = reps_for(bytes);
+    MPIView<char> view(in.data(), bytes);
+    report(mpi, "ring", "wrapper", bytes, measure(mpi, reps, [&]() {
+        if (sendFirst) {
+            mpi.sendMultipleRing<char>(out.data(), bytes);
+        }
+        mpi.receiveMultiple<char>(view, mpi.getPrevRank());
+        if (!sendFirst) {
+            mpi.sendMultipleRing<char>(out.data(), bytes);
+        }
+    }), 1);
+    report(mpi, "ring", "raw", bytes, measure(mpi, reps, [&]() {
+        if (sendFirst) {
+            MPI_Send(out.data(), bytes, MPI_CHAR, mpi.getNextRank(), 0, MCW);
+        }
+        MPI_Recv(in.data(), bytes, MPI_CHAR, mpi.getPrevRank(), 0, MCW, MPI_STATUS_IGNORE);
+        if (!sendFirst) {
+            MPI_Send(out.data(), bytes, MPI_CHAR, mpi.getNextRank(), 0, MCW);
+        }
+    }), 1);
+}
+
+void cube(MPIWrapper& mpi, std::vector<char>& out, std::vector<char>& in, long bytes) {
+    int partner = mpi.getCubeRank(0);
+    bool active = partner < mpi.getSize();
+    bool sendFirst = mpi.getRank() < partner;
+    long reps = reps_for(bytes);
+    MPIView<char> view(in.data(), bytes);
+    report(mpi, "cube", "wrapper", bytes, measure(mpi, reps, [&]() {
+        if (!active) {
+            return;
+        }
+        if (sendFirst) {
+            mpi.sendMultipleCube<char>(out.data(), bytes, 0);
+        }
+        mpi.receiveMultiple<char>(view, partner);
+        if (!sendFirst) {
+            mpi.sendMultipleCube<char>(out.data(), bytes, 0);
+        }
+    }), 1);
+    report(mpi, "cube", "raw", bytes, measure(mpi, reps, [&]() {
+        if (!active) {
+            return;
+        }
+        if (sendFirst) {
+            MPI_Send(out.data(), bytes, MPI_CHAR, partner, 0, MCW);
+        }
+        MPI_Recv(in.data(), bytes, MPI_CHAR, partner, 0, MCW, MPI_STATUS_IGNORE);
+        if (!sendFirst) {
+            MPI_Send(out.data(), bytes, MPI_CHAR, partner, 0, MCW);
+        }
+    }), 1);
+}
+
+void scalar(MPIWrapper& mpi) {
+    int rank = mpi.getRank();
+    long reps = reps_for(sizeof(long));
+    long value = rank;
+    report(mpi, "scalar", "wrapper", sizeof(long), measure(mpi, reps, [&]() {
+        if (rank == 0) {
+            mpi.send<long>(value, 1);
+            value = mpi.receive<long>(1);
+        } else if (rank == 1) {
+            value = mpi.receive<long>(0);
+            mpi.send<long>(value, 0);
+        }
+    }), 0.5);
+    report(mpi, "scalar", "raw", sizeof(long), measure(mpi, reps, [&]() {
+        if (rank == 0) {
+            MPI_Send(&value, 1, MPI_LONG, 1, 0, MCW);
+            MPI_Recv(&value, 1, MPI_LONG, 1, 0, MCW, MPI_STATUS_IGNORE);
+        } else if (rank == 1) {
+            MPI_Recv(&value, 1, MPI_LONG, 0, 0, MCW, MPI_STATUS_IGNORE);
+            MPI_Send(&value, 1, MPI_LONG, 0, 0, MCW);
+        }
+    }), 0.5);
+}
+
+void allreduce(MPIWrapper& mpi, long bytes) {
+    long count = std::max(1L, bytes / (long)sizeof(double));
+    long reps = reps_for(bytes);
+    std::vector<double> values(count, mpi.getRank());
+    std::vector<double> result(count);
+    report(mpi, "allreduce", "wrapper", count * sizeof(double), measure(mpi, reps, [&]() {
+        result = mpi.allreduceMultiple(values, MPI_SUM);
+    }), 1);
+    report(mpi, "allreduce", "raw", count * sizeof(double), measure(mpi, reps, [&]() {
+        MPI_Allreduce(values.data(), result.data(), count, MPI_DOUBLE, MPI_SUM, MCW);
+    }), 1);
+}
+
+int main(int argc, char** argv) {
+    MPIWrapper mpi(argc, argv);
+    long maxBytes = argc > 1 ? atol(argv[1]) : DEFAULT_MAX_BYTES;
+    if (mpi.getSize() < 2) {
+        filter_ios(mpi.getRank(), 0) << "The benchmark needs at least 2 processes." << std::endl;
+        return 1;
+    }
+
+    filter_ios(mpi.getRank(), 0) << "test,path,bytes,reps,p50_us,p90_us,p99_us,mb_per_s" << std::endl;
+    scalar(mpi);
+    std::vector<char> out(maxBytes, 'x');
+    std::vector<char> in(maxBytes);
+    for (long bytes = MIN_BYTES; bytes <= maxBytes; bytes *= 4) {
+        ping_pong(mpi, out, bytes);
+        ring(mpi, out, in, bytes);
+        cube(mpi, out, in, bytes);
+        allreduce(mpi, bytes);
+    }
+}
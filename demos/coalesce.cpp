@@ -0,0 +1,72 @@
+// Throughput of many single-int sends, one message each versus batched
+// through MPICoalescer. Every process sends PER_PEER values to each other
+// process, spread round-robin, and checks for incoming values every
+// POLL_EVERY sends.
+//
+// Run with: ./scripts/runDemo.sh coalesce 4
+#include "../src/mpiwrapper.hpp"
+#include "../src/mpicoalesce.hpp"
+#include <iomanip>
+
+#define PER_PEER 20000
+#define POLL_EVERY 64
+
+void report(MPIWrapper& mpi, std::string name, double seconds, long received) {
+    double slowest = mpi.reduce(seconds, MPI_MAX);
+    long total = mpi.reduce(received, MPI_SUM);
+    long expected = (long)PER_PEER * (mpi.getSize() - 1) * mpi.getSize();
+    if (mpi.getRank() == 0) {
+        std::cout << std::setw(10) << name << ": " << std::fixed << std::setprecision(4) << slowest << "s, "
+            << std::setprecision(0) << total / slowest << " values/s"
+            << (total == expected ? "" : " (values missing!)") << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    MPIWrapper mpi(argc, argv);
+    int size = mpi.getSize();
+    int rank = mpi.getRank();
+    if (size < 2) {
+        filter_ios(rank, 0) << "The demo needs at least 2 processes." << std::endl;
+        return 1;
+    }
+    long count = (long)PER_PEER * (size - 1);
+
+    mpi.barrier();
+    double start = MPI_Wtime();
+    long received = 0;
+    for (long i = 0; i < count; i++) {
+        mpi.send<int>(rank, (rank + 1 + i % (size - 1)) % size);
+        while (i % POLL_EVERY == 0 && mpi.hasData()) {
+            mpi.receive<int>();
+            received++;
+        }
+    }
+    while (received < count) {
+        mpi.receive<int>();
+        received++;
+    }
+    report(mpi, "direct", MPI_Wtime() - start, received);
+
+    mpi.barrier();
+    start = MPI_Wtime();
+    received = 0;
+    {
+        MPICoalescer<int> out(mpi);
+        int value;
+        for (long i = 0; i < count; i++) {
+            out.send(rank, (rank + 1 + i % (size - 1)) % size);
+            while (i % POLL_EVERY == 0 && out.tryReceive(value)) {
+                received++;
+            }
+        }
+        out.flush();
+        while (received < count) {
+            out.receive();
+            received++;
+        }
+        filter_ios(rank, 0) << "Coalesced " << out.getValuesSent() << " values into "
+            << out.getMessagesSent() << " messages on rank 0" << std::endl;
+    }
+    report(mpi, "coalesced", MPI_Wtime() - start, received);
+}
@@ -0,0 +1,99 @@
+// Many exchanges at once on one thread with coroutines. Each process runs
+// PIPELINES ring shifts side by side, each passing a value STEPS times around
+// the ring on its own tag, and one exchange per cube dimension, all at the
+// same time, then checks the results with an awaited allreduce. Every
+// outstanding request goes through one MPI_Testsome per poll.
+//
+// Needs C++20. Run with: CXXSTD=c++20 ./scripts/runDemo.sh coroutines 4
+#include "../src/mpiwrapper.hpp"
+#include "../src/mpicoro.hpp"
+
+#if __cplusplus >= 202002L
+
+#define PIPELINES 8
+#define STEPS 50
+
+/**
+ * Passes a value around the ring STEPS times on its own tag, adding this
+ * rank to it each time it comes through.
+ */
+MPITask<long> ring_shift(MPIWrapper& mpi, MPIScheduler& scheduler, int tag) {
+    long value = tag;
+    for (int step = 0; step < STEPS; step++) {
+        auto sending = scheduler.send<long>(value + mpi.getRank(), mpi.getNextRank(), tag);
+        value = co_await scheduler.receive<long>(mpi.getPrevRank(), tag);
+        co_await sending;
+    }
+    co_return value;
+}
+
+/**
+ * Runs a ring shift and checks it: after STEPS passes the value has gained
+ * every rank's contribution STEPS / size times, plus the partial lap.
+ */
+MPITask<> pipeline(MPIWrapper& mpi, MPIScheduler& scheduler, int tag, int& wrong) {
+    long value = co_await ring_shift(mpi, scheduler, tag);
+    int size = mpi.getSize();
+    long expected = tag;
+    for (int step = 0; step < STEPS; step++) {
+        expected += ((mpi.getRank() - 1 - step) % size + size) % size;
+    }
+    wrong += value != expected;
+}
+
+/**
+ * Swaps ranks with the partner across one cube dimension.
+ */
+MPITask<> cube_swap(MPIWrapper& mpi, MPIScheduler& scheduler, int dimension, long& total) {
+    int partner = mpi.getCubeRank(dimension);
+    if (partner >= mpi.getSize()) {
+        co_return;
+    }
+    auto sending = scheduler.send<int>(mpi.getRank(), partner, 1000 + dimension);
+    total += co_await scheduler.receive<int>(partner, 1000 + dimension);
+    co_await sending;
+}
+
+MPITask<> check(MPIWrapper& mpi, MPIScheduler& scheduler, int& wrong, long& total) {
+    long expected = 0;
+    for (int d = 0; (1 << d) < mpi.getSize(); d++) {
+        int partner = mpi.getCubeRank(d);
+        if (partner < mpi.getSize()) {
+            expected += partner;
+        }
+    }
+    co_await scheduler.barrier();
+    int failures = co_await scheduler.allreduce<int>(wrong + (total != expected), MPI_SUM);
+    filter_ios(mpi.getRank(), 0) << PIPELINES << " ring pipelines and the cube exchanges: "
+        << (failures == 0 ? "ok" : "FAILED") << std::endl;
+}
+
+int main(int argc, char** argv) {
+    MPIWrapper mpi(argc, argv);
+    MPIScheduler scheduler(mpi);
+    int wrong = 0;
+    long total = 0;
+
+    double start = MPI_Wtime();
+    for (int tag = 0; tag < PIPELINES; tag++) {
+        scheduler.spawn(pipeline(mpi, scheduler, tag, wrong));
+    }
+    for (int d = 0; (1 << d) < mpi.getSize(); d++) {
+        scheduler.spawn(cube_swap(mpi, scheduler, d, total));
+    }
+    scheduler.run();
+    double seconds = MPI_Wtime() - start;
+
+    scheduler.spawn(check(mpi, scheduler, wrong, total));
+    scheduler.run();
+    filter_ios(mpi.getRank(), 0) << "time: " << seconds << "s" << std::endl;
+}
+
+#else
+
+int main(int argc, char** argv) {
+    MPIWrapper mpi(argc, argv);
+    filter_ios(mpi.getRank(), 0) << "The coroutine demo needs C++20: CXXSTD=c++20 ./scripts/runDemo.sh coroutines 4" << std::endl;
+}
+
+#endif
@@ -0,0 +1,63 @@
+// Compares the hypercube collectives in mpicube.hpp against the native MPI
+// collectives across message sizes.
+//
+// Run with: ./scripts/runDemo.sh cube_bench 8
+#include "../src/mpiwrapper.hpp"
+#include "../src/mpicube.hpp"
+#include <iomanip>
+
+#define REPS 20
+#define MAX_COUNT (1 << 18)
+
+/**
+ * Times fn over REPS runs and returns the slowest rank's mean in
+ * microseconds.
+ */
+double time_us(MPIWrapper& mpi, std::function<void ()> fn) {
+    fn();
+    mpi.barrier();
+    double start = MPI_Wtime();
+    for (int i = 0; i < REPS; i++) {
+        fn();
+    }
+    double elapsed = (MPI_Wtime() - start) / REPS * 1e6;
+    return mpi.allreduce(elapsed, MPI_MAX);
+}
+
+void report(MPIWrapper& mpi, std::string op, int count, double cube, double native) {
+    filter_ios(mpi.getRank(), 0) << std::setw(10) << op << std::setw(10) << count
+        << std::setw(14) << std::fixed << std::setprecision(1) << cube
+        << std::setw(14) << native
+        << std::setw(8) << std::setprecision(2) << (native / cube) << std::endl;
+}
+
+int main(int argc, char** argv) {
+    MPIWrapper mpi(argc, argv);
+    auto add = [](const double& a, const double& b) { return a + b; };
+
+    filter_ios(mpi.getRank(), 0) << "Hypercube vs native collectives on " << mpi.getSize()
+        << " processes (mean us per call, slowest rank)" << std::endl;
+    filter_ios(mpi.getRank(), 0) << std::setw(10) << "op" << std::setw(10) << "doubles"
+        << std::setw(14) << "cube" << std::setw(14) << "native" << std::setw(8) << "ratio" << std::endl;
+
+    for (int count = 1; count <= MAX_COUNT; count *= 8) {
+        std::vector<double> values(count, mpi.getRank());
+        std::vector<double> block(std::max(1, count / mpi.getSize()), mpi.getRank());
+
+        report(mpi, "allreduce", count,
+            time_us(mpi, [&]() { cube_allreduce<double>(mpi, values, add); }),
+            time_us(mpi, [&]() { mpi.allreduceMultiple<double>(values, MPI_SUM); }));
+        report(mpi, "allgather", block.size() * mpi.getSize(),
+            time_us(mpi, [&]() { cube_allgather<double>(mpi, block); }),
+            time_us(mpi, [&]() { mpi.allgatherMultiple<double>(block); }));
+        report(mpi, "broadcast", count,
+            time_us(mpi, [&]() { cube_broadcast<double>(mpi, values); }),
+            time_us(mpi, [&]() { mpi.broadcastMultiple<double>(values); }));
+        report(mpi, "scan", count,
+            time_us(mpi, [&]() { cube_scan<double>(mpi, values, add); }),
+            time_us(mpi, [&]() {
+                std::vector<double> out(values.size());
+                MPI_Scan(values.data(), out.data(), values.size(), MPI_DOUBLE, MPI_SUM, MCW);
+            }));
+    }
+}
@@ -0,0 +1,70 @@
+// Split communicators and node-aware collectives. The processes split into
+// even and odd ranks and sum their ranks within each half. Then
+// allreduceHierarchical and broadcastHierarchical are checked against
+// allreduceMultiple and broadcastMultiple, with an MPI_Op and a lambda, for
+// vectors and single values, and for broadcasts from rank 0 and from the
+// last rank. Prints ok or FAILED for each, and the time each way for VALUES
+// doubles.
+//
+// Run with: ./scripts/runDemo.sh hierarchical 4
+#include "../src/mpiwrapper.hpp"
+
+#define VALUES (1L << 20)
+
+void check(MPIWrapper& mpi, std::string name, bool ok) {
+    ok = mpi.allreduce<int>(ok, MPI_LAND);
+    filter_ios(mpi.getRank(), 0) << name << ": " << (ok ? "ok" : "FAILED") << std::endl;
+}
+
+int main(int argc, char** argv) {
+    MPIWrapper mpi(argc, argv);
+    int rank = mpi.getRank();
+    int size = mpi.getSize();
+
+    MPIWrapper half = mpi.split(rank % 2);
+    int expected = 0;
+    for (int i = rank % 2; i < size; i += 2) {
+        expected += i;
+    }
+    check(mpi, "split", half.getSize() == (size + 1 - rank % 2) / 2 && half.allreduce(rank, MPI_SUM) == expected);
+
+    filter_ios(rank, 0) << mpi.getLeaders().getSize() << " node(s), "
+        << mpi.getNode().getSize() << " process(es) on rank 0's node" << std::endl;
+
+    std::vector<double> values(VALUES);
+    for (long i = 0; i < VALUES; i++) {
+        values[i] = rank + i % 7;
+    }
+    auto max = [](const double& a, const double& b) { return a > b ? a : b; };
+
+    mpi.barrier();
+    double start = MPI_Wtime();
+    std::vector<double> flat = mpi.allreduceMultiple(values, MPI_SUM);
+    double flatSeconds = mpi.allreduce(MPI_Wtime() - start, MPI_MAX);
+    start = MPI_Wtime();
+    std::vector<double> tiered = mpi.allreduceHierarchical(values, MPI_SUM);
+    double tieredSeconds = mpi.allreduce(MPI_Wtime() - start, MPI_MAX);
+    check(mpi, "allreduceHierarchical, MPI_SUM", tiered == flat);
+    check(mpi, "allreduceHierarchical, lambda",
+        mpi.allreduceHierarchical(values, max) == mpi.allreduceMultiple(values, max));
+    check(mpi, "allreduceHierarchical, scalar MPI_SUM",
+        mpi.allreduceHierarchical(rank, MPI_SUM) == mpi.allreduce(rank, MPI_SUM));
+    check(mpi, "allreduceHierarchical, scalar lambda",
+        mpi.allreduceHierarchical<int>(rank, [](const int& a, const int& b) { return a > b ? a : b; }) == size - 1);
+
+    for (int root : {0, size - 1}) {
+        std::vector<double> flatCopy;
+        std::vector<double> tieredCopy;
+        if (rank == root) {
+            flatCopy = values;
+            tieredCopy = values;
+        }
+        mpi.broadcastMultiple(flatCopy, root);
+        mpi.broadcastHierarchical(tieredCopy, root);
+        check(mpi, "broadcastHierarchical from rank " + std::to_string(root),
+            tieredCopy == flatCopy && tieredCopy.size() == (size_t)VALUES && tieredCopy[1] == root + 1);
+    }
+
+    filter_ios(rank, 0) << "allreduce of " << VALUES << " doubles: " << flatSeconds << "s flat, "
+        << tieredSeconds << "s hierarchical" << std::endl;
+}
@@ -0,0 +1,86 @@
+// Scattered updates to a distributed table with one-sided operations. Every
+// process adds 1 to UPDATES random buckets of a table of BUCKETS_PER_RANK
+// buckets per process, first with accumulate in a fence epoch and then in
+// a passive lock epoch, where the targets never take part. Then every
+// process takes TICKETS tickets from a counter on rank 0 with fetchAndOp, and
+// the tickets are checked to be unique.
+//
+// Run with: ./scripts/runDemo.sh rma 4
+#include "../src/mpiwrapper.hpp"
+#include <algorithm>
+#include <random>
+
+#define BUCKETS_PER_RANK 1024
+#define UPDATES 100000
+#define TICKETS 100
+
+long table_total(MPIWrapper& mpi, MPIWindow<long>& table) {
+    long local = 0;
+    for (long count : table) {
+        local += count;
+    }
+    return mpi.allreduce(local, MPI_SUM);
+}
+
+int main(int argc, char** argv) {
+    MPIWrapper mpi(argc, argv);
+    int rank = mpi.getRank();
+    int size = mpi.getSize();
+    long expected = (long)UPDATES * size;
+
+    MPIWindow<long> table = mpi.createWindow<long>(BUCKETS_PER_RANK);
+    std::fill(table.begin(), table.end(), 0);
+    std::mt19937 random(rank);
+    std::uniform_int_distribution<long> bucket(0, (long)BUCKETS_PER_RANK * size - 1);
+    const long one = 1;
+
+    mpi.barrier();
+    double start = MPI_Wtime();
+    {
+        MPIFenceEpoch<long> epoch(table);
+        for (int i = 0; i < UPDATES; i++) {
+            long index = bucket(random);
+            table.accumulate(one, index / BUCKETS_PER_RANK, index % BUCKETS_PER_RANK);
+        }
+    }
+    double seconds = mpi.allreduce(MPI_Wtime() - start, MPI_MAX);
+    long total = table_total(mpi, table);
+    filter_ios(rank, 0) << "fence epoch: " << seconds << "s, " << expected / seconds << " updates/s, "
+        << (total == expected ? "ok" : "FAILED") << std::endl;
+
+    mpi.barrier();
+    start = MPI_Wtime();
+    {
+        MPILockEpoch<long> epoch(table);
+        for (int i = 0; i < UPDATES; i++) {
+            long index = bucket(random);
+            table.accumulate(one, index / BUCKETS_PER_RANK, index % BUCKETS_PER_RANK);
+        }
+    }
+    seconds = mpi.allreduce(MPI_Wtime() - start, MPI_MAX);
+    // Everyone's updates are complete once everyone has unlocked.
+    mpi.barrier();
+    {
+        MPILockEpoch<long> own(table, rank);
+        total = table_total(mpi, table);
+    }
+    filter_ios(rank, 0) << "lock epoch: " << seconds << "s, " << expected / seconds << " updates/s, "
+        << (total == 2 * expected ? "ok" : "FAILED") << std::endl;
+
+    MPIWindow<long> counter = mpi.createWindow<long>(rank == 0 ? 1 : 0);
+    if (rank == 0) {
+        counter[0] = 0;
+    }
+    mpi.barrier();
+    std::vector<long> tickets(TICKETS);
+    for (long& ticket : tickets) {
+        MPILockEpoch<long> epoch(counter, 0);
+        counter.fetchAndOp(one, ticket, 0, 0);
+    }
+    std::vector<long> all = mpi.gatherMultiple(tickets);
+    if (rank == 0) {
+        std::sort(all.begin(), all.end());
+        bool unique = std::unique(all.begin(), all.end()) == all.end() && all.back() == (long)all.size() - 1;
+        std::cout << "fetchAndOp tickets: " << (unique ? "ok" : "FAILED") << std::endl;
+    }
+}
@@ -0,0 +1,149 @@
+// Serialization against MPI_Pack for a vector of variable-size records, each
+// a name, a vector of values and an id. Prints one CSV row per method and
+// message size:
+//
+//     method,records,bytes,encode_us,decode_us,roundtrip_us
+//
+// Encode and decode are timed on rank 0 alone; the round trip is a ping-pong
+// between ranks 0 and 1 including encoding and decoding on both ends.
+//
+// Run with: ./scripts/runDemo.sh serial_bench 2
+#include "../src/mpiwrapper.hpp"
+#include <cstdio>
+
+#define REPS 50
+#define MAX_RECORDS 10000
+
+struct Record {
+    std::string name;
+    std::vector<double> values;
+    int id;
+
+    template<typename A>
+    void serialize(A& archive) {
+        archive(name, values, id);
+    }
+};
+
+std::vector<Record> make_records(int count) {
+    std::vector<Record> records(count);
+    for (int i = 0; i < count; i++) {
+        records[i].name = "record-" + std::to_string(i);
+        records[i].values.assign(i % 17, i * 0.25);
+        records[i].id = i;
+    }
+    return records;
+}
+
+/**
+ * Packs records with MPI_Pack, sizing the buffer with MPI_Pack_size first,
+ * as length-prefixed fields in the same order as the serializer.
+ */
+std::vector<char> pack(const std::vector<Record>& records) {
+    int total = 0;
+    int part;
+    MPI_Pack_size(1, MPI_INT, MCW, &part);
+    total += part;
+    for (const Record& record : records) {
+        MPI_Pack_size(3, MPI_INT, MCW, &part);
+        total += part;
+        MPI_Pack_size(record.name.size(), MPI_CHAR, MCW, &part);
+        total += part;
+        MPI_Pack_size(record.values.size(), MPI_DOUBLE, MCW, &part);
+        total += part;
+    }
+    std::vector<char> buffer(total);
+    int position = 0;
+    int count = records.size();
+    MPI_Pack(&count, 1, MPI_INT, buffer.data(), total, &position, MCW);
+    for (const Record& record : records) {
+        int lengths[3] = {(int)record.name.size(), (int)record.values.size(), record.id};
+        MPI_Pack(lengths, 3, MPI_INT, buffer.data(), total, &position, MCW);
+        MPI_Pack(record.name.data(), lengths[0], MPI_CHAR, buffer.data(), total, &position, MCW);
+        MPI_Pack(record.values.data(), lengths[1], MPI_DOUBLE, buffer.data(), total, &position, MCW);
+    }
+    buffer.resize(position);
+    return buffer;
+}
+
+std::vector<Record> unpack(const std::vector<char>& buffer) {
+    int position = 0;
+    int count;
+    MPI_Unpack(buffer.data(), buffer.size(), &position, &count, 1, MPI_INT, MCW);
+    std::vector<Record> records(count);
+    for (Record& record : records) {
+        int lengths[3];
+        MPI_Unpack(buffer.data(), buffer.size(), &position, lengths, 3, MPI_INT, MCW);
+        record.name.resize(lengths[0]);
+        record.values.resize(lengths[1]);
+        record.id = lengths[2];
+        MPI_Unpack(buffer.data(), buffer.size(), &position, &record.name[0], lengths[0], MPI_CHAR, MCW);
+        MPI_Unpack(buffer.data(), buffer.size(), &position, record.values.data(), lengths[1], MPI_DOUBLE, MCW);
+    }
+    return records;
+}
+
+/**
+ * @returns The average time of fn over REPS runs, in microseconds.
+ */
+double time_us(std::function<void ()> fn) {
+    double start = MPI_Wtime();
+    for (int i = 0; i < REPS; i++) {
+        fn();
+    }
+    return (MPI_Wtime() - start) / REPS * 1e6;
+}
+
+int main(int argc, char** argv) {
+    MPIWrapper mpi(argc, argv);
+    int rank = mpi.getRank();
+    if (mpi.getSize() < 2) {
+        filter_ios(rank, 0) << "The benchmark needs at least 2 processes." << std::endl;
+        return 0;
+    }
+    filter_ios(rank, 0) << "method,records,bytes,encode_us,decode_us,roundtrip_us" << std::endl;
+
+    for (int count = 10; count <= MAX_RECORDS; count *= 10) {
+        std::vector<Record> records = make_records(count);
+        std::vector<Record> result;
+
+        // Serializer: encode, one send, one probe-sized receive, decode.
+        MPISerializer encoded = mpi_serialize(records);
+        double encode = time_us([&]() { encoded = mpi_serialize(records); });
+        double decode = time_us([&]() {
+            result = mpi_deserialize<std::vector<Record>>(encoded.data(), encoded.size());
+        });
+        mpi.barrier();
+        double roundtrip = time_us([&]() {
+            if (rank == 0) {
+                mpi.sendSerialized(records, 1);
+                result = mpi.receiveSerialized<std::vector<Record>>(1);
+            } else if (rank == 1) {
+                result = mpi.receiveSerialized<std::vector<Record>>(0);
+                mpi.sendSerialized(result, 0);
+            }
+        });
+        if (rank == 0) {
+            printf("serialize,%d,%zu,%.1f,%.1f,%.1f\n", count, encoded.size(), encode, decode, roundtrip);
+        }
+
+        // MPI_Pack: size, pack, send, probe, receive, unpack.
+        std::vector<char> packed = pack(records);
+        encode = time_us([&]() { packed = pack(records); });
+        decode = time_us([&]() { result = unpack(packed); });
+        mpi.barrier();
+        roundtrip = time_us([&]() {
+            if (rank == 0) {
+                mpi.sendMultiple(pack(records), 1);
+                result = unpack(mpi.receiveVector<char>(1));
+            } else if (rank == 1) {
+                std::vector<char> incoming = mpi.receiveVector<char>(0);
+                mpi.sendMultiple(pack(unpack(incoming)), 0);
+            }
+        });
+        if (rank == 0) {
+            printf("mpi_pack,%d,%zu,%.1f,%.1f,%.1f\n", count, packed.size(), encode, decode, roundtrip);
+        }
+        mpi.barrier();
+    }
+}
@@ -0,0 +1,63 @@
+// Node-shared memory. First a lookup table of TABLE values is handed to
+// every process, once with broadcastMultiple (one copy per process) and once
+// with shareTable (one copy per node), and both are checked. Then each
+// process fills its own segment of a shared array and sums its next
+// neighbor's segment in place, with no messages.
+//
+// Run with: ./scripts/runDemo.sh shared 4
+#include "../src/mpiwrapper.hpp"
+
+#define TABLE (1L << 22)
+#define SEGMENT 1000
+
+int main(int argc, char** argv) {
+    MPIWrapper mpi(argc, argv);
+    int rank = mpi.getRank();
+    MPIWrapper& node = mpi.getNode();
+
+    std::vector<double> table;
+    if (rank == 0) {
+        for (long i = 0; i < TABLE; i++) {
+            table.push_back(i * 0.5);
+        }
+    }
+
+    mpi.barrier();
+    double start = MPI_Wtime();
+    std::vector<double> copy(table);
+    mpi.broadcastMultiple(copy);
+    double copied = mpi.allreduce(MPI_Wtime() - start, MPI_MAX);
+    bool copyOk = mpi.allreduce<int>(copy[TABLE - 1] == (TABLE - 1) * 0.5, MPI_LAND);
+
+    mpi.barrier();
+    start = MPI_Wtime();
+    MPISharedArray<double> shared = mpi.shareTable(table);
+    double sharing = mpi.allreduce(MPI_Wtime() - start, MPI_MAX);
+    const double* lookup = shared.at(0);
+    bool sharedOk = mpi.allreduce<int>(lookup[TABLE - 1] == (TABLE - 1) * 0.5, MPI_LAND);
+
+    int nodes = mpi.allreduce<int>(mpi.isNodeLeader(), MPI_SUM);
+    double megabytes = TABLE * sizeof(double) / 1e6;
+    filter_ios(rank, 0) << "broadcast: " << copied << "s, " << megabytes * mpi.getSize() << " MB held, "
+        << (copyOk ? "ok" : "FAILED") << std::endl;
+    filter_ios(rank, 0) << "shareTable: " << sharing << "s, " << megabytes * nodes << " MB held, "
+        << (sharedOk ? "ok" : "FAILED") << std::endl;
+
+    // Each process writes its own segment, then reads its neighbor's.
+    MPISharedArray<long> segments = mpi.allocateShared<long>(SEGMENT);
+    for (long i = 0; i < SEGMENT; i++) {
+        segments[i] = node.getRank() * SEGMENT + i;
+    }
+    segments.barrier();
+    int neighbor = node.getNextRank();
+    long count;
+    const long* theirs = segments.at(neighbor, count);
+    long sum = 0;
+    for (long i = 0; i < count; i++) {
+        sum += theirs[i];
+    }
+    long expected = neighbor * SEGMENT * SEGMENT + SEGMENT * (SEGMENT - 1) / 2;
+    bool neighborOk = mpi.allreduce<int>(sum == expected, MPI_LAND);
+    filter_ios(rank, 0) << "neighbor segments: " << (neighborOk ? "ok" : "FAILED") << std::endl;
+    segments.barrier();
+}
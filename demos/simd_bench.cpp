@@ -0,0 +1,74 @@
+// Local reduction kernels at each SIMD level this CPU supports, then an
+// allreduce of a large array with MPI_SUM and with mpi_simd_op. Prints one
+// CSV row per kernel, type and level:
+//
+//     kernel,type,level,us,gb_per_s
+//
+// Times are the best of REPS runs over VALUES values on rank 0.
+//
+// Run with: ./scripts/runDemo.sh simd_bench 2
+#include "../src/mpiwrapper.hpp"
+#include <cstdio>
+
+#define VALUES (1L << 22)
+#define REPS 20
+
+volatile double sink;
+
+/**
+ * @returns The best time of fn over REPS runs, in seconds.
+ */
+double best_of(std::function<double ()> fn) {
+    double best = 1e30;
+    for (int i = 0; i < REPS; i++) {
+        double start = MPI_Wtime();
+        sink = fn();
+        best = std::min(best, MPI_Wtime() - start);
+    }
+    return best;
+}
+
+void row(const char* kernel, const char* type, MPISimdLevel level, double seconds, long bytes) {
+    printf("%s,%s,%s,%.1f,%.2f\n", kernel, type, simd_level_name(level), seconds * 1e6, bytes / seconds / 1e9);
+}
+
+template<typename T>
+void bench(const char* type, MPISimdLevel level) {
+    std::vector<T> a(VALUES);
+    std::vector<T> b(VALUES);
+    for (long i = 0; i < VALUES; i++) {
+        a[i] = (T)(i % 1000);
+        b[i] = (T)(i % 7);
+    }
+    long bytes = VALUES * sizeof(T);
+    simd_set_level(level);
+    row("sum", type, level, best_of([&]() { return (double)local_sum(a.data(), VALUES); }), bytes);
+    row("max", type, level, best_of([&]() { return (double)local_max(a.data(), VALUES); }), bytes);
+    row("minmax", type, level, best_of([&]() { return (double)local_minmax(a.data(), VALUES).second; }), bytes);
+    row("argmax", type, level, best_of([&]() { return (double)local_argmax(a.data(), VALUES); }), bytes);
+    row("dot", type, level, best_of([&]() { return (double)local_dot(a.data(), b.data(), VALUES); }), 2 * bytes);
+}
+
+int main(int argc, char** argv) {
+    MPIWrapper mpi(argc, argv);
+    if (mpi.getRank() == 0) {
+        printf("kernel,type,level,us,gb_per_s\n");
+        for (int level = SIMD_SCALAR; level <= simd_supported(); level++) {
+            bench<double>("double", (MPISimdLevel)level);
+            bench<float>("float", (MPISimdLevel)level);
+            bench<int>("int", (MPISimdLevel)level);
+            bench<long>("long", (MPISimdLevel)level);
+        }
+        simd_set_level(simd_supported());
+    }
+
+    std::vector<double> values(VALUES, mpi.getRank());
+    long bytes = VALUES * sizeof(double);
+    mpi.barrier();
+    double builtin = best_of([&]() { return mpi.allreduceMultiple(values, MPI_SUM)[0]; });
+    double simd = best_of([&]() { return mpi.allreduceMultiple(values, mpi_simd_op<double>::sum())[0]; });
+    if (mpi.getRank() == 0) {
+        row("allreduce MPI_SUM", "double", SIMD_SCALAR, builtin, bytes);
+        row("allreduce mpi_simd_op", "double", simd_get_level(), simd, bytes);
+    }
+}
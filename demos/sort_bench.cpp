@@ -0,0 +1,71 @@
+// Weak and strong scaling of the distributed sorts. Weak scaling gives every
+// process the same number of keys; strong scaling splits a fixed number of
+// keys across however many processes there are. Prints one CSV row per
+// algorithm and mode:
+//
+//     algorithm,scaling,ranks,keys,seconds,mkeys_per_s
+//
+// Run with: ./scripts/runSortBench.sh 8 [keys per rank] [total keys]
+// to sweep 1, 2, 4 and 8 processes, or ./scripts/runDemo.sh sort_bench 4
+// for one process count.
+#include "../src/mpiwrapper.hpp"
+#include "../src/mpisort.hpp"
+#include <cstdio>
+#include <cstdlib>
+
+#define DEFAULT_PER_RANK (1L << 20)
+#define DEFAULT_TOTAL (1L << 22)
+
+/**
+ * Fills a vector with keys that depend only on their global index, so every
+ * run sorts the same keys whatever the process count.
+ */
+DistributedVector<double> keys(MPIWrapper& mpi, long total) {
+    DistributedVector<double> values(mpi, total);
+    values.for_each([](double& value, long index) {
+        unsigned long hash = index * 0x9E3779B97F4A7C15UL;
+        hash ^= hash >> 31;
+        value = (hash >> 11) * (1.0 / (1UL << 53));
+    });
+    return values;
+}
+
+bool check(MPIWrapper& mpi, const DistributedVector<double>& values) {
+    const std::vector<double>& local = values.local();
+    bool sorted = std::is_sorted(local.begin(), local.end());
+    std::vector<double> firsts = mpi.allgather<double>(local.empty() ? -1 : local.front());
+    std::vector<double> lasts = mpi.allgather<double>(local.empty() ? -1 : local.back());
+    for (int i = 1; i < mpi.getSize(); i++) {
+        sorted = sorted && (firsts[i] < 0 || lasts[i - 1] <= firsts[i]);
+    }
+    return mpi.allreduce<int>(sorted, MPI_LAND);
+}
+
+void run(MPIWrapper& mpi, std::string scaling, long total) {
+    for (int algorithm = 0; algorithm < 2; algorithm++) {
+        DistributedVector<double> values = keys(mpi, total);
+        mpi.barrier();
+        double start = MPI_Wtime();
+        if (algorithm == 0) {
+            sample_sort(values);
+        } else {
+            cube_quicksort(values);
+        }
+        double seconds = mpi.allreduce(MPI_Wtime() - start, MPI_MAX);
+        bool sorted = check(mpi, values);
+        if (mpi.getRank() == 0) {
+            printf("%s,%s,%d,%ld,%.6f,%.3f%s\n", algorithm == 0 ? "sample" : "cube_quicksort", scaling.c_str(),
+                mpi.getSize(), total, seconds, total / seconds / 1e6, sorted ? "" : ",UNSORTED");
+            fflush(stdout);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    MPIWrapper mpi(argc, argv);
+    long perRank = argc > 1 ? atol(argv[1]) : DEFAULT_PER_RANK;
+    long total = argc > 2 ? atol(argv[2]) : DEFAULT_TOTAL;
+    filter_ios(mpi.getRank(), 0) << "algorithm,scaling,ranks,keys,seconds,mkeys_per_s" << std::endl;
+    run(mpi, "weak", perRank * mpi.getSize());
+    run(mpi, "strong", total);
+}
@@ -0,0 +1,54 @@
+// Adaptive Simpson integration of a spiky function with the work-stealing
+// task pool. All work starts on rank 0; the other processes get theirs by
+// stealing.
+//
+// Run with: ./scripts/runDemo.sh steal 4
+#include "../src/mpiwrapper.hpp"
+#include "../src/mpisteal.hpp"
+#include <cmath>
+#include <iomanip>
+
+#define TOLERANCE 1e-10
+
+typedef std::array<double, 2> Interval;
+
+double f(double x) {
+    return std::sin(1.0 / (x + 0.01)) * std::exp(-x);
+}
+
+double simpson(double a, double b) {
+    return (b - a) / 6.0 * (f(a) + 4.0 * f((a + b) / 2.0) + f(b));
+}
+
+int main(int argc, char** argv) {
+    MPIWrapper mpi(argc, argv);
+    srand(mpi.getRank() * 100 + 1);
+    double area = 0;
+
+    MPITaskPool<Interval> pool(mpi, [&area](const Interval& task, MPITaskPool<Interval>& pool) {
+        double a = task[0];
+        double b = task[1];
+        double m = (a + b) / 2.0;
+        double whole = simpson(a, b);
+        double halves = simpson(a, m) + simpson(m, b);
+        if (std::fabs(halves - whole) < 15 * TOLERANCE * (b - a)) {
+            area += halves;
+        } else {
+            pool.push({{a, m}});
+            pool.push({{m, b}});
+        }
+    });
+
+    if (mpi.getRank() == 0) {
+        pool.push({{0.0, 3.0}});
+    }
+    double start = MPI_Wtime();
+    pool.run();
+    double elapsed = MPI_Wtime() - start;
+
+    double total = mpi.reduce(area, MPI_SUM);
+    mpi.table<long>(pool.getExecuted(), "Tasks run");
+    mpi.table<long>(pool.getStealsWon(), "Successful steals");
+    filter_ios(mpi.getRank(), 0) << std::setprecision(12) << "Integral: " << total
+        << " in " << elapsed << "s" << std::endl;
+}
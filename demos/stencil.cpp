@@ -0,0 +1,65 @@
+// 2D Jacobi heat diffusion on a Cartesian grid, overlapping the halo
+// exchange with the interior update and running until the largest change
+// anywhere falls below a tolerance.
+//
+// Run with: ./scripts/runDemo.sh stencil 4
+#include "../src/mpiwrapper.hpp"
+#include "../src/mpihalo.hpp"
+#include "../src/mpiiterate.hpp"
+#include <cmath>
+
+#define ROWS 32
+#define COLS 32
+#define TOLERANCE 2e-2
+#define MAX_STEPS 5000
+#define CHECK_EVERY 10
+
+int main(int argc, char** argv) {
+    MPIWrapper mpi(argc, argv);
+    mpi.createGrid({0, 0});
+    MPIHaloExchange<double> halo(mpi, {ROWS, COLS});
+
+    std::vector<double> current(halo.size(), 0.0);
+    std::vector<double> next(halo.size(), 0.0);
+    // A hot spot in the middle of every process's block.
+    current[halo.index({ROWS / 2, COLS / 2})] = 1000.0;
+
+    double change = 0;
+    auto update = [&](int row, int col) {
+        size_t i = halo.index({row, col});
+        next[i] = 0.25 * (current[halo.index({row - 1, col})] + current[halo.index({row + 1, col})]
+            + current[halo.index({row, col - 1})] + current[halo.index({row, col + 1})]);
+        change = std::max(change, std::fabs(next[i] - current[i]));
+    };
+
+    MPIIterator solver(mpi, TOLERANCE, MAX_STEPS, CHECK_EVERY);
+    solver.run([&](MPIIterationContext& context) {
+        change = 0;
+        halo.exchange(current.data(), [&]() {
+            for (int row = 2; row < ROWS; row++) {
+                for (int col = 2; col < COLS; col++) {
+                    update(row, col);
+                }
+            }
+        });
+        for (int k = 1; k <= COLS; k++) {
+            update(1, k);
+            update(ROWS, k);
+        }
+        for (int k = 2; k < ROWS; k++) {
+            update(k, 1);
+            update(k, COLS);
+        }
+        current.swap(next);
+        context.residual = change;
+    });
+    solver.report("Jacobi");
+
+    double heat = 0;
+    for (int row = 1; row <= ROWS; row++) {
+        for (int col = 1; col <= COLS; col++) {
+            heat += current[halo.index({row, col})];
+        }
+    }
+    mpi.table<long>((long)heat, "Heat per block");
+}
@@ -2,7 +2,7 @@
 #include "src/mpitype.hpp"
 #include "src/mpiwrapper.hpp"
 
-bool run(MPIWrapper mpi) {
+bool run(MPIWrapper& mpi) {
     srand(mpi.getRank() * 100);
     long send = rand() % (mpi.getSize() * 100);
     mpi.table<long>(send, "First");
@@ -0,0 +1,4 @@
+#!/bin/bash
+IMPL=$(find ./src -name "*.cpp" -print)
+mpic++ -std=c++11 -O2 demos/bench.cpp $IMPL -o bench.out && mpirun -np $1 -oversubscribe ./bench.out ${@:2}
+rm bench.out
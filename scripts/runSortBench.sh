@@ -0,0 +1,7 @@
+#!/bin/bash
+IMPL=$(find ./src -name "*.cpp" -print)
+mpic++ -std=c++11 -O2 demos/sort_bench.cpp $IMPL -o sort_bench.out || exit 1
+for ((np = 1; np <= $1; np *= 2)); do
+    mpirun -np $np -oversubscribe ./sort_bench.out ${@:2} | if ((np > 1)); then tail -n +2; else cat; fi
+done
+rm sort_bench.out
@@ -0,0 +1,265 @@
+#ifndef MPI_COALESCE_HPP
+#define MPI_COALESCE_HPP
+#include <deque>
+#include <map>
+#include <utility>
+#include <vector>
+#include "mpiwrapper.hpp"
+
+#define COALESCE_DEFAULT_BATCH 1024
+#define COALESCE_DEFAULT_DELAY 1e-3
+
+/**
+ * Batches many small sends to the same destination into one message.
+ *
+ * Values sent through the coalescer are buffered per destination and tag,
+ * and go out as a single message once a buffer holds a batch's worth of
+ * values, once the oldest buffered value has waited longer than the delay,
+ * or on flush(). Receiving through the coalescer unpacks batches back into
+ * single values, in the order each sender sent them. Thousands of scalar
+ * sends then pay MPI's per-message latency once instead of once each.
+ *
+ * Both sides of a tag must go through a coalescer, since batches are sent
+ * as plain messages on the caller's tag. Any values still buffered when the
+ * coalescer is destroyed are flushed.
+ *
+ *     MPICoalescer<int> out(mpi);
+ *     for (...) {
+ *         out.send(value, mpi.getRandomRank());
+ *         while (out.tryReceive(value)) {
+ *             handle(value, out.getLastSource());
+ *         }
+ *     }
+ *     out.flush();
+ *
+ * @param T The MPI-supported type to send.
+ */
+template<typename T>
+class MPICoalescer {
+private:
+    struct Batch {
+        std::vector<T> values;
+        double since = 0;
+    };
+
+    struct Flight {
+        MPIRequest<T> request;
+        std::vector<T> values;
+    };
+
+    struct Arrival {
+        int source;
+        int tag;
+        T value;
+    };
+
+    MPIWrapper& mpi;
+    size_t batchSize;
+    double maxDelay;
+    std::map<std::pair<int, int>, Batch> batches;
+    std::deque<Flight> inFlight;
+    std::deque<Arrival> arrivals;
+    double oldest = -1;
+    int lastSource = MPI_ANY_SOURCE;
+    int lastTag = MPI_ANY_TAG;
+    long messagesSent = 0;
+    long valuesSent = 0;
+
+    void sendBatch(int destination, int tag, Batch& batch) {
+        if (batch.values.empty()) {
+            return;
+        }
+        // The values move into the flight record, whose storage MPI reads
+        // from until the send completes.
+        inFlight.push_back(Flight());
+        Flight& flight = inFlight.back();
+        flight.values.swap(batch.values);
+        flight.request = mpi.isendMultiple<T>(flight.values, destination, tag);
+        batch.values.reserve(batchSize);
+        messagesSent++;
+        valuesSent += flight.values.size();
+    }
+
+    void reap() {
+        while (!inFlight.empty() && inFlight.front().request.test()) {
+            inFlight.pop_front();
+        }
+    }
+
+    /**
+     * Receives one waiting batch into the arrival queue, if any.
+     */
+    bool pull(int source, int tag) {
+        MPI_Status status;
+        if (!mpi.hasData(source, tag, &status)) {
+            return false;
+        }
+        std::vector<T> values;
+        mpi.receiveMultiple<T>(values, status.MPI_SOURCE, status.MPI_TAG);
+        for (const T& value : values) {
+            arrivals.push_back(Arrival{status.MPI_SOURCE, status.MPI_TAG, value});
+        }
+        return true;
+    }
+
+    bool take(T& value, int source, int tag) {
+        for (auto it = arrivals.begin(); it != arrivals.end(); ++it) {
+            if ((source == MPI_ANY_SOURCE || it->source == source) && (tag == MPI_ANY_TAG || it->tag == tag)) {
+                value = it->value;
+                lastSource = it->source;
+                lastTag = it->tag;
+                arrivals.erase(it);
+                return true;
+            }
+        }
+        return false;
+    }
+
+public:
+    /**
+     * @param mpi The wrapper to send through.
+     * @param batchSize How many values to buffer for one destination and tag
+     * before sending them. Defaults to 1024.
+     * @param maxDelay How many seconds a value may wait in a buffer before
+     * every buffer is flushed. Checked on each send, tryReceive and poll.
+     * Defaults to 1ms.
+     */
+    MPICoalescer(MPIWrapper& mpi, size_t batchSize=COALESCE_DEFAULT_BATCH, double maxDelay=COALESCE_DEFAULT_DELAY) :
+        mpi(mpi), batchSize(batchSize), maxDelay(maxDelay) {}
+
+    MPICoalescer(const MPICoalescer& other) = delete;
+    MPICoalescer& operator=(const MPICoalescer& other) = delete;
+
+    ~MPICoalescer() {
+        flush();
+        for (Flight& flight : inFlight) {
+            flight.request.wait();
+        }
+    }
+
+    /**
+     * Buffers a value for the given process, sending the buffer if it is
+     * full or has waited too long.
+     *
+     * @param value The value to send.
+     * @param destination The rank of the process to send to.
+     * @param tag The tag to send the value with. Defaults to 0.
+     */
+    void send(const T& value, int destination, int tag=0) {
+        Batch& batch = batches[std::make_pair(destination, tag)];
+        if (batch.values.empty()) {
+            batch.since = MPI_Wtime();
+            if (oldest < 0) {
+                oldest = batch.since;
+            }
+        }
+        batch.values.push_back(value);
+        if (batch.values.size() >= batchSize) {
+            sendBatch(destination, tag, batch);
+        }
+        poll();
+    }
+
+    /**
+     * Sends every buffer if the oldest buffered value has waited longer than
+     * the delay. send() and tryReceive() call this; call it directly to keep
+     * values moving through a stretch that does neither.
+     */
+    void poll() {
+        if (oldest >= 0 && MPI_Wtime() - oldest > maxDelay) {
+            flush();
+        }
+    }
+
+    /**
+     * Sends every buffered value now.
+     */
+    void flush() {
+        for (auto& entry : batches) {
+            sendBatch(entry.first.first, entry.first.second, entry.second);
+        }
+        oldest = -1;
+        reap();
+    }
+
+    /**
+     * Takes a received value if one is available, first sending any buffers
+     * that have waited too long. Does not block.
+     *
+     * @param value Set to the value received.
+     * @param source The process to receive from. Defaults to allow any.
+     * @param tag The tag the value must have. Defaults to allow any.
+     *
+     * @return If a value was received.
+     */
+    bool tryReceive(T& value, int source=MPI_ANY_SOURCE, int tag=MPI_ANY_TAG) {
+        poll();
+        if (take(value, source, tag)) {
+            return true;
+        }
+        while (pull(source, tag)) {
+            if (take(value, source, tag)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Receives a value, blocking until one arrives. Flushes this process's
+     * buffers first, so that two processes waiting on each other do not
+     * deadlock.
+     *
+     * @param source The process to receive from. Defaults to allow any.
+     * @param tag The tag the value must have. Defaults to allow any.
+     *
+     * @return The value received.
+     */
+    T receive(int source=MPI_ANY_SOURCE, int tag=MPI_ANY_TAG) {
+        T value;
+        if (take(value, source, tag)) {
+            return value;
+        }
+        flush();
+        while (true) {
+            std::vector<T> values;
+            mpi.receiveMultiple<T>(values, source, tag);
+            for (const T& received : values) {
+                arrivals.push_back(Arrival{mpi.getLastSource(), mpi.getLastTag(), received});
+            }
+            if (take(value, source, tag)) {
+                return value;
+            }
+        }
+    }
+
+    /**
+     * @returns The process the last value received came from.
+     */
+    int getLastSource() {
+        return lastSource;
+    }
+
+    /**
+     * @returns The tag of the last value received.
+     */
+    int getLastTag() {
+        return lastTag;
+    }
+
+    /**
+     * @returns The number of batched messages sent.
+     */
+    long getMessagesSent() {
+        return messagesSent;
+    }
+
+    /**
+     * @returns The number of values sent, across all batches.
+     */
+    long getValuesSent() {
+        return valuesSent;
+    }
+};
+
+#endif // MPI_COALESCE_HPP
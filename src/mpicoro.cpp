@@ -0,0 +1,69 @@
+#include "mpicoro.hpp"
+
+#if __cplusplus >= 202002L
+
+MPIScheduler::MPIScheduler(MPIWrapper& mpi) : mpi(mpi) {}
+
+void MPIScheduler::spawn(MPITask<void>&& task) {
+    this->ready.push_back(task.getHandle());
+    this->tasks.push_back(std::move(task));
+}
+
+void MPIScheduler::suspend(const MPIRequestBase& request, std::coroutine_handle<> waiting) {
+    this->waiting.push_back(request);
+    this->waiters.push_back(waiting);
+}
+
+bool MPIScheduler::poll() {
+    while (!this->ready.empty()) {
+        std::coroutine_handle<> next = this->ready.front();
+        this->ready.pop_front();
+        next.resume();
+    }
+
+    if (!this->waiting.empty()) {
+        this->mpi.testSome(this->waiting);
+        // Sweep every request rather than only those Testsome reported:
+        // one completed elsewhere (by its own wait(), the progress engine,
+        // or another awaiter) already has a null handle and is never
+        // reported. Queue the waiters before resuming any, since resuming
+        // adds to the lists.
+        size_t kept = 0;
+        for (size_t i = 0; i < this->waiting.size(); i++) {
+            if (this->waiting[i].isDone()) {
+                this->ready.push_back(this->waiters[i]);
+                continue;
+            }
+            this->waiting[kept] = this->waiting[i];
+            this->waiters[kept] = this->waiters[i];
+            kept++;
+        }
+        this->waiting.resize(kept);
+        this->waiters.resize(kept);
+    }
+
+    std::vector<MPITask<void>> finished;
+    size_t kept = 0;
+    for (size_t i = 0; i < this->tasks.size(); i++) {
+        if (this->tasks[i].isDone()) {
+            finished.push_back(std::move(this->tasks[i]));
+        } else {
+            this->tasks[kept++] = std::move(this->tasks[i]);
+        }
+    }
+    this->tasks.resize(kept);
+    for (MPITask<void>& task : finished) {
+        task.result();
+    }
+    return !this->tasks.empty() || !this->ready.empty();
+}
+
+void MPIScheduler::run() {
+    while (poll()) {}
+}
+
+size_t MPIScheduler::getWaiting() const {
+    return this->waiting.size();
+}
+
+#endif // __cplusplus >= 202002L
@@ -0,0 +1,437 @@
+#ifndef MPI_CORO_HPP
+#define MPI_CORO_HPP
+
+//
+// Coroutines
+//
+// Lets one process run many exchanges at once without threads or hand-written
+// state machines. Each exchange is written as a coroutine returning MPITask,
+// which co_awaits sends, receives and collectives from an MPIScheduler; the
+// scheduler keeps every awaited request in one list and completes them in
+// batches with MPI_Testsome, resuming whichever coroutines they unblock.
+//
+//     MPITask<> shift(MPIScheduler& scheduler, int tag) {
+//         co_await scheduler.send(value, mpi.getNextRank(), tag);
+//         int incoming = co_await scheduler.receive<int>(mpi.getPrevRank(), tag);
+//     }
+//
+//     MPIScheduler scheduler(mpi);
+//     scheduler.spawn(shift(scheduler, 0));
+//     scheduler.spawn(shift(scheduler, 1));
+//     scheduler.run();
+//
+// Needs C++20; with older standards this header is empty and the rest of the
+// wrapper works as before.
+//
+
+#if __cplusplus >= 202002L
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <utility>
+#include <vector>
+#include "mpiwrapper.hpp"
+
+template<typename T>
+class MPITask;
+
+/**
+ * What MPITask's promises have in common: the coroutine waiting on this one,
+ * resumed when it finishes, and any exception it ended with.
+ */
+struct MPITaskPromiseBase {
+    std::coroutine_handle<> continuation;
+    std::exception_ptr error;
+
+    struct FinalAwaiter {
+        bool await_ready() noexcept {
+            return false;
+        }
+
+        template<typename P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> finished) noexcept {
+            std::coroutine_handle<> next = finished.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept {
+        return {};
+    }
+
+    FinalAwaiter final_suspend() noexcept {
+        return {};
+    }
+
+    void unhandled_exception() {
+        this->error = std::current_exception();
+    }
+};
+
+template<typename T>
+struct MPITaskPromise : public MPITaskPromiseBase {
+    T value;
+
+    MPITask<T> get_return_object();
+
+    void return_value(T value) {
+        this->value = std::move(value);
+    }
+
+    T result() {
+        if (this->error) {
+            std::rethrow_exception(this->error);
+        }
+        return std::move(this->value);
+    }
+};
+
+template<>
+struct MPITaskPromise<void> : public MPITaskPromiseBase {
+    MPITask<void> get_return_object();
+
+    void return_void() {}
+
+    void result() {
+        if (this->error) {
+            std::rethrow_exception(this->error);
+        }
+    }
+};
+
+/**
+ * A coroutine that communicates through an MPIScheduler. Starts only when
+ * spawned on a scheduler or awaited by another task, which then gets its
+ * result, or its exception. Movable but not copyable; destroying the task
+ * destroys the coroutine.
+ *
+ * @param T The type the coroutine co_returns. Defaults to void.
+ */
+template<typename T=void>
+class MPITask {
+public:
+    using promise_type = MPITaskPromise<T>;
+
+private:
+    std::coroutine_handle<promise_type> handle;
+
+public:
+    MPITask() {}
+    explicit MPITask(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+    MPITask(MPITask&& other) : handle(std::exchange(other.handle, nullptr)) {}
+
+    MPITask& operator=(MPITask&& other) {
+        if (this != &other) {
+            if (this->handle) {
+                this->handle.destroy();
+            }
+            this->handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+
+    MPITask(const MPITask& other) = delete;
+    MPITask& operator=(const MPITask& other) = delete;
+
+    ~MPITask() {
+        if (this->handle) {
+            this->handle.destroy();
+        }
+    }
+
+    /**
+     * @returns If the coroutine has run to the end.
+     */
+    bool isDone() const {
+        return !this->handle || this->handle.done();
+    }
+
+    /**
+     * @returns The value the finished coroutine returned.
+     *
+     * @throws Whatever the coroutine threw.
+     */
+    T result() {
+        return this->handle.promise().result();
+    }
+
+    /**
+     * @returns The coroutine, to resume it.
+     */
+    std::coroutine_handle<> getHandle() const {
+        return this->handle;
+    }
+
+    bool await_ready() const {
+        return isDone();
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> waiting) {
+        this->handle.promise().continuation = waiting;
+        return this->handle;
+    }
+
+    T await_resume() {
+        return result();
+    }
+};
+
+template<typename T>
+MPITask<T> MPITaskPromise<T>::get_return_object() {
+    return MPITask<T>(std::coroutine_handle<MPITaskPromise<T>>::from_promise(*this));
+}
+
+inline MPITask<void> MPITaskPromise<void>::get_return_object() {
+    return MPITask<void>(std::coroutine_handle<MPITaskPromise<void>>::from_promise(*this));
+}
+
+class MPIScheduler;
+
+/**
+ * Awaits a request on a scheduler, then turns the completed request into
+ * the result of the co_await.
+ *
+ * @param T The type the request transfers.
+ * @param F The function making the result, as R(MPIRequest<T>&).
+ */
+template<typename T, typename F>
+class MPIRequestAwaiter {
+private:
+    MPIScheduler& scheduler;
+    MPIRequest<T> request;
+    F finish;
+
+public:
+    MPIRequestAwaiter(MPIScheduler& scheduler, MPIRequest<T> request, F finish) :
+        scheduler(scheduler), request(request), finish(finish) {}
+
+    bool await_ready() {
+        return this->request.test();
+    }
+
+    void await_suspend(std::coroutine_handle<> waiting);
+
+    auto await_resume() {
+        return this->finish(this->request);
+    }
+};
+
+/**
+ * Runs MPITask coroutines on one process, resuming each when the request it
+ * awaits completes. Every awaited request goes into one list that poll()
+ * tests with a single MPI_Testsome, so many exchanges proceed together
+ * without blocking. Not thread-safe; use one scheduler per thread.
+ */
+class MPIScheduler {
+private:
+    MPIWrapper& mpi;
+    std::vector<MPITask<void>> tasks;
+    std::deque<std::coroutine_handle<>> ready;
+    std::vector<MPIRequestBase> waiting;
+    std::vector<std::coroutine_handle<>> waiters;
+
+    /**
+     * Starts a non-blocking collective whose input and result live in the
+     * request, with input at buffer[1] and result at buffer[0]. The wrapper
+     * tracks it, so the buffer outlives a task destroyed mid-await.
+     *
+     * @param value The input, copied into both slots.
+     * @param start Starts the collective, as void(MPITypedRequestState<T>&).
+     */
+    template<typename T, typename S>
+    MPIRequest<T> collective(const T& value, S start) {
+        std::shared_ptr<MPITypedRequestState<T>> state = std::make_shared<MPITypedRequestState<T>>();
+        state->buffer.assign(2, value);
+        start(*state);
+        this->mpi.track(state);
+        return MPIRequest<T>(state);
+    }
+
+    template<typename T, typename F>
+    MPIRequestAwaiter<T, F> await(MPIRequest<T> request, F finish) {
+        return MPIRequestAwaiter<T, F>(*this, request, finish);
+    }
+
+public:
+    /**
+     * @param mpi The wrapper to communicate through.
+     */
+    MPIScheduler(MPIWrapper& mpi);
+
+    MPIScheduler(const MPIScheduler& other) = delete;
+    MPIScheduler& operator=(const MPIScheduler& other) = delete;
+
+    /**
+     * Takes a task to run. It starts on the next poll().
+     *
+     * @param task The task.
+     */
+    void spawn(MPITask<void>&& task);
+
+    /**
+     * Resumes the coroutine once a request completes. Called by awaiters.
+     *
+     * @param request The request awaited.
+     * @param waiting The coroutine awaiting it.
+     */
+    void suspend(const MPIRequestBase& request, std::coroutine_handle<> waiting);
+
+    /**
+     * Resumes every coroutine that is ready to run, then tests every awaited
+     * request once with MPI_Testsome and resumes the coroutines of those
+     * that completed. Does not block, so it can be called from a work loop.
+     *
+     * @return If any spawned task is unfinished.
+     *
+     * @throws Whatever a finished task threw.
+     */
+    bool poll();
+
+    /**
+     * Polls until every spawned task has finished.
+     *
+     * @throws Whatever a task threw.
+     */
+    void run();
+
+    /**
+     * @returns The number of requests being awaited.
+     */
+    size_t getWaiting() const;
+
+    //
+    // Awaitables
+    //
+
+    /**
+     * Sends a value.
+     *
+     * @param value The value to send. Copied, so it may change at once.
+     * @param destination The rank to send to.
+     * @param tag The tag to send with. Defaults to 0.
+     * @param T The MPI-supported type to send.
+     *
+     * @return An awaitable, resuming once the send completes.
+     */
+    template<typename T>
+    auto send(const T& value, const int& destination, const int& tag=0) {
+        return await(mpi.isend<T>(value, destination, tag), [](MPIRequest<T>&) {});
+    }
+
+    /**
+     * Sends a vector of values.
+     *
+     * @param values The values to send. Copied, so they may change at once.
+     * @param destination The rank to send to.
+     * @param tag The tag to send with. Defaults to 0.
+     * @param T The MPI-supported type to send.
+     *
+     * @return An awaitable, resuming once the send completes.
+     */
+    template<typename T>
+    auto sendMultiple(const std::vector<T>& values, const int& destination, const int& tag=0) {
+        return await(mpi.isendMultiple<T>(values, destination, tag), [](MPIRequest<T>&) {});
+    }
+
+    /**
+     * Receives a value.
+     *
+     * @param source The rank to receive from. Defaults to any.
+     * @param tag The tag to match. Defaults to any.
+     * @param T The MPI-supported type to receive.
+     *
+     * @return An awaitable giving the value.
+     */
+    template<typename T>
+    auto receive(const int& source=MPI_ANY_SOURCE, const int& tag=MPI_ANY_TAG) {
+        return await(mpi.irecv<T>(source, tag), [](MPIRequest<T>& request) { return request.get(); });
+    }
+
+    /**
+     * Receives up to count values.
+     *
+     * @param count The most values to receive.
+     * @param source The rank to receive from. Defaults to any.
+     * @param tag The tag to match. Defaults to any.
+     * @param T The MPI-supported type to receive.
+     *
+     * @return An awaitable giving the values received.
+     */
+    template<typename T>
+    auto receiveMultiple(const int& count, const int& source=MPI_ANY_SOURCE, const int& tag=MPI_ANY_TAG) {
+        return await(mpi.irecvMultiple<T>(count, source, tag), [](MPIRequest<T>& request) {
+            const std::vector<T>& buffer = request.getAll();
+            return std::vector<T>(buffer.begin(), buffer.begin() + request.getCount());
+        });
+    }
+
+    /**
+     * Awaits a request started elsewhere, such as with MPIWrapper::isend.
+     *
+     * @param request The request.
+     *
+     * @return An awaitable giving the completed request.
+     */
+    template<typename T>
+    auto wait(MPIRequest<T> request) {
+        return await(request, [](MPIRequest<T>& request) { return request; });
+    }
+
+    /**
+     * Waits for every process to reach the barrier, with MPI_Ibarrier.
+     *
+     * @return An awaitable, resuming once every process has arrived.
+     */
+    auto barrier() {
+        MPIRequest<char> request = collective<char>(0, [this](MPITypedRequestState<char>& state) {
+            MPI_Ibarrier(mpi.getComm(), &state.request);
+        });
+        return await(request, [](MPIRequest<char>&) {});
+    }
+
+    /**
+     * Sends a value from the root to every process, with MPI_Ibcast.
+     *
+     * @param value The value on the root. Ignored elsewhere.
+     * @param root The rank to broadcast from. Defaults to 0.
+     * @param T The MPI-supported type to broadcast.
+     *
+     * @return An awaitable giving the root's value.
+     */
+    template<typename T>
+    auto broadcast(const T& value, const int& root=0) {
+        MPIRequest<T> request = collective<T>(value, [this, root](MPITypedRequestState<T>& state) {
+            MPI_Ibcast(state.buffer.data(), 1, mpi_type<T>::get(), root, mpi.getComm(), &state.request);
+        });
+        return await(request, [](MPIRequest<T>& request) { return request.get(); });
+    }
+
+    /**
+     * Combines a value from every process, with MPI_Iallreduce.
+     *
+     * @param value This process's contribution.
+     * @param op The operation to combine values with, such as MPI_SUM.
+     * @param T The MPI-supported type to reduce.
+     *
+     * @return An awaitable giving the combined value.
+     */
+    template<typename T>
+    auto allreduce(const T& value, MPI_Op op) {
+        MPIRequest<T> request = collective<T>(value, [this, op](MPITypedRequestState<T>& state) {
+            MPI_Iallreduce(&state.buffer[1], &state.buffer[0], 1, mpi_type<T>::get(), op, mpi.getComm(), &state.request);
+        });
+        return await(request, [](MPIRequest<T>& request) { return request.get(); });
+    }
+};
+
+template<typename T, typename F>
+void MPIRequestAwaiter<T, F>::await_suspend(std::coroutine_handle<> waiting) {
+    this->scheduler.suspend(this->request, waiting);
+}
+
+#endif // __cplusplus >= 202002L
+
+#endif // MPI_CORO_HPP
@@ -0,0 +1,17 @@
+#include "mpicube.hpp"
+
+int cube_span(int size) {
+    int span = 1;
+    while (span * 2 <= size) {
+        span *= 2;
+    }
+    return span;
+}
+
+int cube_dimensions(int size) {
+    int dimensions = 0;
+    while ((1 << (dimensions + 1)) <= size) {
+        dimensions++;
+    }
+    return dimensions;
+}
@@ -0,0 +1,303 @@
+#ifndef MPI_CUBE_HPP
+#define MPI_CUBE_HPP
+#include <vector>
+#include "mpiwrapper.hpp"
+
+//
+// Hypercube Collectives
+//
+// Collective algorithms built on getCubeRank. Each runs in log2(p) exchange
+// steps. When the number of processes is not a power of two, the ranks past
+// the largest power of two fold their data into a partner inside the cube
+// first and are handed the result afterwards.
+//
+
+#define CUBE_TAG 0x7C00
+
+/**
+ * @param size The number of processes.
+ *
+ * @return The largest power of two no greater than size.
+ */
+int cube_span(int size);
+
+/**
+ * @param size The number of processes.
+ *
+ * @return The number of dimensions of the cube used for size processes.
+ */
+int cube_dimensions(int size);
+
+/**
+ * Swaps a vector with the process across the given rank, sizing the incoming
+ * vector from the message itself.
+ *
+ * @param mpi The wrapper to communicate through.
+ * @param partner The rank to swap with.
+ * @param out The values to send.
+ * @param in The vector to receive into.
+ * @param tag The tag to exchange on.
+ * @param T The MPI-supported type to exchange.
+ */
+template<typename T>
+void cube_exchange(MPIWrapper& mpi, int partner, const std::vector<T>& out, std::vector<T>& in, int tag) {
+    MPIRequest<T> sent = mpi.isendMultiple<T>(out, partner, tag);
+    mpi.receiveMultiple<T>(in, partner, tag);
+    sent.wait();
+}
+
+/**
+ * Combines vectors from every process element by element with recursive
+ * doubling, and gives the result to all of them. Every process must pass the
+ * same number of values. Partners always combine the lower rank's values on
+ * the left, so every process ends with bit-identical results.
+ *
+ * @param mpi The wrapper to communicate through.
+ * @param values This process's contribution.
+ * @param fn The function to combine values with, as T(const T&, const T&).
+ * @param T The MPI-supported type to reduce.
+ *
+ * @return The combined values.
+ *
+ * @order O(log p) messages of n values.
+ */
+template<typename T, typename F>
+std::vector<T> cube_allreduce(MPIWrapper& mpi, const std::vector<T>& values, const F& fn) {
+    int rank = mpi.getRank();
+    int span = cube_span(mpi.getSize());
+    std::vector<T> result(values);
+    std::vector<T> incoming;
+
+    if (rank >= span) {
+        mpi.sendMultiple<T>(result, rank - span, CUBE_TAG);
+        mpi.receiveMultiple<T>(result, rank - span, CUBE_TAG);
+        return result;
+    }
+    if (rank + span < mpi.getSize()) {
+        mpi.receiveMultiple<T>(incoming, rank + span, CUBE_TAG);
+        for (size_t i = 0; i < result.size(); i++) {
+            result[i] = fn(result[i], incoming[i]);
+        }
+    }
+
+    for (int d = 0; (1 << d) < span; d++) {
+        int partner = mpi.getCubeRank(d);
+        cube_exchange<T>(mpi, partner, result, incoming, CUBE_TAG + 1);
+        for (size_t i = 0; i < result.size(); i++) {
+            result[i] = partner < rank ? fn(incoming[i], result[i]) : fn(result[i], incoming[i]);
+        }
+    }
+
+    if (rank + span < mpi.getSize()) {
+        mpi.sendMultiple<T>(result, rank + span, CUBE_TAG);
+    }
+    return result;
+}
+
+/**
+ * Combines a value from every process with recursive doubling, and gives the
+ * result to all of them.
+ *
+ * @param mpi The wrapper to communicate through.
+ * @param value This process's contribution.
+ * @param fn The function to combine values with, as T(const T&, const T&).
+ * @param T The MPI-supported type to reduce.
+ *
+ * @return The combined value.
+ *
+ * @order O(log p).
+ */
+template<typename T, typename F>
+T cube_allreduce(MPIWrapper& mpi, const T& value, const F& fn) {
+    return cube_allreduce<T>(mpi, std::vector<T>(1, value), fn)[0];
+}
+
+/**
+ * Collects a vector from every process into every process by exchanging
+ * along one dimension at a time, doubling the data held at each step.
+ * Vectors may differ in length.
+ *
+ * @param mpi The wrapper to communicate through.
+ * @param values This process's contribution.
+ * @param T The MPI-supported type to gather.
+ *
+ * @return The values concatenated in rank order.
+ *
+ * @order O(log p) messages, O(n p) values moved.
+ */
+template<typename T>
+std::vector<T> cube_allgather(MPIWrapper& mpi, const std::vector<T>& values) {
+    int rank = mpi.getRank();
+    int size = mpi.getSize();
+    int span = cube_span(size);
+    // Blocks held so far, with the owner and length of each.
+    std::vector<T> data(values);
+    std::vector<int> blocks;
+    blocks.push_back(rank);
+    blocks.push_back(values.size());
+
+    if (rank >= span) {
+        mpi.sendMultiple<T>(data, rank - span, CUBE_TAG);
+        std::vector<T> result;
+        mpi.receiveMultiple<T>(result, rank - span, CUBE_TAG);
+        return result;
+    }
+    if (rank + span < size) {
+        std::vector<T> extra;
+        mpi.receiveMultiple<T>(extra, rank + span, CUBE_TAG);
+        data.insert(data.end(), extra.begin(), extra.end());
+        blocks.push_back(rank + span);
+        blocks.push_back(extra.size());
+    }
+
+    std::vector<T> incomingData;
+    std::vector<int> incomingBlocks;
+    for (int d = 0; (1 << d) < span; d++) {
+        int partner = mpi.getCubeRank(d);
+        cube_exchange<int>(mpi, partner, blocks, incomingBlocks, CUBE_TAG + 1);
+        cube_exchange<T>(mpi, partner, data, incomingData, CUBE_TAG + 2);
+        data.insert(data.end(), incomingData.begin(), incomingData.end());
+        blocks.insert(blocks.end(), incomingBlocks.begin(), incomingBlocks.end());
+    }
+
+    std::vector<int> counts(size);
+    std::vector<int> sources(size);
+    for (size_t i = 0, offset = 0; i < blocks.size(); i += 2) {
+        sources[blocks[i]] = offset;
+        counts[blocks[i]] = blocks[i + 1];
+        offset += blocks[i + 1];
+    }
+    std::vector<T> result;
+    result.reserve(data.size());
+    for (int i = 0; i < size; i++) {
+        result.insert(result.end(), data.begin() + sources[i], data.begin() + sources[i] + counts[i]);
+    }
+
+    if (rank + span < size) {
+        mpi.sendMultiple<T>(result, rank + span, CUBE_TAG);
+    }
+    return result;
+}
+
+/**
+ * Collects a value from every process into every process by dimension
+ * exchange.
+ *
+ * @param mpi The wrapper to communicate through.
+ * @param value This process's contribution.
+ * @param T The MPI-supported type to gather.
+ *
+ * @return The values in rank order.
+ *
+ * @order O(log p).
+ */
+template<typename T>
+std::vector<T> cube_allgather(MPIWrapper& mpi, const T& value) {
+    return cube_allgather<T>(mpi, std::vector<T>(1, value));
+}
+
+/**
+ * Sends a vector from the root to every process along a binomial tree laid
+ * over the cube, so the number of processes holding the data doubles each
+ * step. Works for any number of processes: partners past the end are
+ * skipped.
+ *
+ * @param mpi The wrapper to communicate through.
+ * @param values The values to send on the root, and the vector to fill
+ * everywhere else.
+ * @param root The rank to broadcast from. Defaults to 0.
+ * @param T The MPI-supported type to broadcast.
+ *
+ * @order O(log p).
+ */
+template<typename T>
+void cube_broadcast(MPIWrapper& mpi, std::vector<T>& values, int root=0) {
+    int size = mpi.getSize();
+    int relative = (mpi.getRank() - root + size) % size;
+    for (int d = 0; (1 << d) < size; d++) {
+        int partner = relative ^ (1 << d);
+        if (relative < (1 << d) && partner < size) {
+            mpi.sendMultiple<T>(values, (partner + root) % size, CUBE_TAG);
+        } else if (partner < relative && relative < (2 << d)) {
+            mpi.receiveMultiple<T>(values, (partner + root) % size, CUBE_TAG);
+        }
+    }
+}
+
+/**
+ * Sends a value from the root to every process along a binomial tree.
+ *
+ * @param mpi The wrapper to communicate through.
+ * @param value The value to send on the root, and the value to fill
+ * everywhere else.
+ * @param root The rank to broadcast from. Defaults to 0.
+ * @param T The MPI-supported type to broadcast.
+ *
+ * @order O(log p).
+ */
+template<typename T>
+void cube_broadcast(MPIWrapper& mpi, T& value, int root=0) {
+    std::vector<T> values(1, value);
+    cube_broadcast<T>(mpi, values, root);
+    value = values[0];
+}
+
+/**
+ * Combines vectors element by element from this process and every lower
+ * rank. Each step swaps the running total of a subcube with its partner, and
+ * folds the partner's total into the prefix when the partner is lower.
+ * Partners past the end are skipped, which is safe because no process below
+ * the end needs their (empty) totals.
+ *
+ * @param mpi The wrapper to communicate through.
+ * @param values This process's contribution.
+ * @param fn The function to combine values with, as T(const T&, const T&).
+ * Must be associative, but need not be commutative.
+ * @param T The MPI-supported type to scan.
+ *
+ * @return The combined values of ranks 0 through this one.
+ *
+ * @order O(log p).
+ */
+template<typename T, typename F>
+std::vector<T> cube_scan(MPIWrapper& mpi, const std::vector<T>& values, const F& fn) {
+    int rank = mpi.getRank();
+    std::vector<T> prefix(values);
+    std::vector<T> total(values);
+    std::vector<T> incoming;
+    for (int d = 0; (1 << d) < mpi.getSize(); d++) {
+        int partner = mpi.getCubeRank(d);
+        if (partner >= mpi.getSize()) {
+            continue;
+        }
+        cube_exchange<T>(mpi, partner, total, incoming, CUBE_TAG + 1);
+        for (size_t i = 0; i < total.size(); i++) {
+            if (partner < rank) {
+                prefix[i] = fn(incoming[i], prefix[i]);
+                total[i] = fn(incoming[i], total[i]);
+            } else {
+                total[i] = fn(total[i], incoming[i]);
+            }
+        }
+    }
+    return prefix;
+}
+
+/**
+ * Combines a value from this process and every lower rank.
+ *
+ * @param mpi The wrapper to communicate through.
+ * @param value This process's contribution.
+ * @param fn The function to combine values with, as T(const T&, const T&).
+ * @param T The MPI-supported type to scan.
+ *
+ * @return The combined value of ranks 0 through this one.
+ *
+ * @order O(log p).
+ */
+template<typename T, typename F>
+T cube_scan(MPIWrapper& mpi, const T& value, const F& fn) {
+    return cube_scan<T>(mpi, std::vector<T>(1, value), fn)[0];
+}
+
+#endif // MPI_CUBE_HPP
@@ -0,0 +1,22 @@
+#include "mpifile.hpp"
+#include <stdexcept>
+
+MPI_File mpi_file_open(MPI_Comm comm, const std::string& path, int mode, MPI_Datatype type) {
+    MPI_File file;
+    int error = MPI_File_open(comm, path.c_str(), mode, MPI_INFO_NULL, &file);
+    if (error != MPI_SUCCESS) {
+        char message[MPI_MAX_ERROR_STRING];
+        int length;
+        MPI_Error_string(error, message, &length);
+        throw std::runtime_error("Could not open " + path + ": " + std::string(message, length));
+    }
+    MPI_File_set_view(file, 0, type, type, "native", MPI_INFO_NULL);
+    return file;
+}
+
+MPI_Offset mpi_file_extent(MPI_Datatype type) {
+    MPI_Aint lowerBound;
+    MPI_Aint extent;
+    MPI_Type_get_extent(type, &lowerBound, &extent);
+    return extent;
+}
@@ -0,0 +1,121 @@
+#ifndef MPI_FILE_HPP
+#define MPI_FILE_HPP
+#include <mpi.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include "mpitype.hpp"
+
+/**
+ * Opens a file on every process of a communicator, with the file viewed as
+ * a flat array of one type.
+ *
+ * @param comm The communicator to open the file on.
+ * @param path The file to open.
+ * @param mode The MPI_MODE_* flags to open with.
+ * @param type The element type of the view.
+ *
+ * @return The open file.
+ *
+ * @throws std::runtime_error If the file could not be opened. Opening is
+ * collective, so every process throws.
+ */
+MPI_File mpi_file_open(MPI_Comm comm, const std::string& path, int mode, MPI_Datatype type);
+
+/**
+ * @param type The element type of a view set by mpi_file_open.
+ *
+ * @returns The bytes each value takes in the file. The view tiles the file
+ * by the type's extent, so this includes any padding in a struct type.
+ */
+MPI_Offset mpi_file_extent(MPI_Datatype type);
+
+/**
+ * An in-flight split-collective read or write of one process's block of a
+ * shared file, started by MPIWrapper::startWriteBlocks or startReadBlocks.
+ * Owns the buffer being transferred and the open file. Movable but not
+ * copyable; finishing is collective, and happens on destruction if not done
+ * sooner.
+ *
+ * @param T The MPI-supported type being transferred.
+ */
+template<typename T>
+class MPIFileTransfer {
+private:
+    MPI_File file;
+    std::vector<T> buffer;
+    bool reading;
+
+public:
+    MPIFileTransfer() : file(MPI_FILE_NULL), reading(false) {}
+
+    /**
+     * Starts the transfer.
+     *
+     * @param file The open file, viewed as an array of T. Closed once the
+     * transfer finishes.
+     * @param buffer The values to write, or a buffer sized for the values to
+     * read.
+     * @param offset The index in the file of this process's first value.
+     * @param reading Whether to read rather than write.
+     */
+    MPIFileTransfer(MPI_File file, std::vector<T>&& buffer, MPI_Offset offset, bool reading) :
+        file(file), buffer(std::move(buffer)), reading(reading) {
+        if (reading) {
+            MPI_File_read_at_all_begin(file, offset, this->buffer.data(), this->buffer.size(), mpi_type<T>::get());
+        } else {
+            MPI_File_write_at_all_begin(file, offset, this->buffer.data(), this->buffer.size(), mpi_type<T>::get());
+        }
+    }
+
+    MPIFileTransfer(MPIFileTransfer&& other) :
+        file(other.file), buffer(std::move(other.buffer)), reading(other.reading) {
+        other.file = MPI_FILE_NULL;
+    }
+
+    MPIFileTransfer& operator=(MPIFileTransfer&& other) {
+        if (this != &other) {
+            finish();
+            this->file = other.file;
+            this->buffer = std::move(other.buffer);
+            this->reading = other.reading;
+            other.file = MPI_FILE_NULL;
+        }
+        return *this;
+    }
+
+    MPIFileTransfer(const MPIFileTransfer& other) = delete;
+    MPIFileTransfer& operator=(const MPIFileTransfer& other) = delete;
+
+    ~MPIFileTransfer() {
+        finish();
+    }
+
+    /**
+     * Waits for the transfer and closes the file. Must be called on every
+     * process that started it.
+     *
+     * @return The values read, or the values written.
+     */
+    std::vector<T>& finish() {
+        if (this->file != MPI_FILE_NULL) {
+            MPI_Status status;
+            if (this->reading) {
+                MPI_File_read_at_all_end(this->file, this->buffer.data(), &status);
+            } else {
+                MPI_File_write_at_all_end(this->file, this->buffer.data(), &status);
+            }
+            MPI_File_close(&this->file);
+        }
+        return this->buffer;
+    }
+
+    /**
+     * @returns If the transfer has been finished.
+     */
+    bool isFinished() const {
+        return this->file == MPI_FILE_NULL;
+    }
+};
+
+#endif // MPI_FILE_HPP
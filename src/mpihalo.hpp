@@ -0,0 +1,180 @@
+#ifndef MPI_HALO_HPP
+#define MPI_HALO_HPP
+#include <mpi.h>
+#include <vector>
+#include "mpitype.hpp"
+#include "mpiwrapper.hpp"
+
+#define HALO_TAG 0x4A00
+
+/**
+ * Exchanges the ghost faces of a process's block of a grid with its
+ * neighbors in the wrapper's Cartesian grid.
+ *
+ * The block is stored row-major (last dimension contiguous) with a ghost
+ * layer of the given width on every side. Faces are described to MPI as
+ * strided subarray datatypes built once up front, so nothing is packed or
+ * copied. Only faces are exchanged, not edges or corners, which is what
+ * star-shaped stencils need.
+ *
+ * Typical use overlaps the exchange with work that only touches interior
+ * cells:
+ *
+ *     halo.start(data);
+ *     updateInterior(data);
+ *     halo.finish();
+ *     updateBoundary(data);
+ *
+ * @param T The MPI-supported type of each cell.
+ */
+template<typename T>
+class MPIHaloExchange {
+private:
+    MPI_Comm grid;
+    int ghost;
+    std::vector<int> interior;
+    std::vector<int> extents;
+    std::vector<int> neighbors;
+    std::vector<MPI_Datatype> sendFaces;
+    std::vector<MPI_Datatype> recvFaces;
+    std::vector<MPI_Request> requests;
+
+    MPI_Datatype face(int dimension, int start) {
+        std::vector<int> subsizes(interior);
+        std::vector<int> starts(interior.size(), ghost);
+        subsizes[dimension] = ghost;
+        starts[dimension] = start;
+        MPI_Datatype type;
+        MPI_Type_create_subarray(extents.size(), extents.data(), subsizes.data(), starts.data(),
+            MPI_ORDER_C, mpi_type<T>::get(), &type);
+        MPI_Type_commit(&type);
+        return type;
+    }
+
+public:
+    /**
+     * Builds the face datatypes for a block. The wrapper must already have a
+     * grid with as many dimensions as the block.
+     *
+     * @param mpi The wrapper whose grid to exchange over.
+     * @param interior The number of cells this process owns along each
+     * dimension, not counting ghosts.
+     * @param ghost The width of the ghost layer. Defaults to 1.
+     */
+    MPIHaloExchange(MPIWrapper& mpi, const std::vector<int>& interior, int ghost=1) :
+        grid(mpi.getGrid()), ghost(ghost), interior(interior) {
+        for (size_t d = 0; d < interior.size(); d++) {
+            extents.push_back(interior[d] + 2 * ghost);
+        }
+        for (size_t d = 0; d < interior.size(); d++) {
+            int lower;
+            int upper;
+            MPI_Cart_shift(grid, d, 1, &lower, &upper);
+            neighbors.push_back(lower);
+            neighbors.push_back(upper);
+            sendFaces.push_back(face(d, ghost));
+            sendFaces.push_back(face(d, interior[d]));
+            recvFaces.push_back(face(d, 0));
+            recvFaces.push_back(face(d, interior[d] + ghost));
+        }
+    }
+
+    MPIHaloExchange(const MPIHaloExchange& other) = delete;
+    MPIHaloExchange& operator=(const MPIHaloExchange& other) = delete;
+
+    ~MPIHaloExchange() {
+        finish();
+        for (size_t i = 0; i < sendFaces.size(); i++) {
+            MPI_Type_free(&sendFaces[i]);
+            MPI_Type_free(&recvFaces[i]);
+        }
+    }
+
+    /**
+     * @returns The number of cells in the block, ghosts included.
+     */
+    size_t size() const {
+        size_t total = 1;
+        for (int extent : extents) {
+            total *= extent;
+        }
+        return total;
+    }
+
+    /**
+     * @returns The length of the block along each dimension, ghosts
+     * included.
+     */
+    const std::vector<int>& getExtents() const {
+        return extents;
+    }
+
+    /**
+     * @param coords Coordinates within the block, where ghost cells on the
+     * low side are at 0 and the first interior cell is at the ghost width.
+     *
+     * @returns The offset of the cell in the row-major block.
+     */
+    size_t index(const std::vector<int>& coords) const {
+        size_t offset = 0;
+        for (size_t d = 0; d < extents.size(); d++) {
+            offset = offset * extents[d] + coords[d];
+        }
+        return offset;
+    }
+
+    /**
+     * Starts sending this block's boundary faces and receiving neighbors'
+     * faces into the ghost layer. Neither the boundary cells nor the ghost
+     * cells may be touched until finish().
+     *
+     * @param data The block, ghosts included.
+     */
+    void start(T* data) {
+        finish();
+        requests.resize(2 * sendFaces.size());
+        for (size_t i = 0; i < sendFaces.size(); i++) {
+            // Face i goes to the neighbor on side i, which files it under
+            // the opposite side.
+            int side = i % 2;
+            MPI_Irecv(data, 1, recvFaces[i], neighbors[i], HALO_TAG + (i - side) + (1 - side), grid, &requests[2 * i]);
+            MPI_Isend(data, 1, sendFaces[i], neighbors[i], HALO_TAG + i, grid, &requests[2 * i + 1]);
+        }
+    }
+
+    /**
+     * Blocks until the exchange started by start() has completed.
+     */
+    void finish() {
+        if (!requests.empty()) {
+            MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+            requests.clear();
+        }
+    }
+
+    /**
+     * Exchanges ghost faces, running the given work while the exchange is in
+     * flight.
+     *
+     * @param data The block, ghosts included.
+     * @param overlap Work that touches neither boundary nor ghost cells.
+     */
+    template<typename F>
+    void exchange(T* data, F overlap) {
+        start(data);
+        overlap();
+        finish();
+    }
+
+    /**
+     * Exchanges ghost faces.
+     *
+     * @param data The block, ghosts included.
+     */
+    void exchange(T* data) {
+        start(data);
+        finish();
+    }
+};
+
+#endif // MPI_HALO_HPP
@@ -0,0 +1,77 @@
+#include "mpiiterate.hpp"
+#include <algorithm>
+#include <iomanip>
+
+MPIIterator::MPIIterator(MPIWrapper& mpi, double tolerance, long maxIterations, int checkInterval, MPI_Op norm) :
+    mpi(mpi), tolerance(tolerance), maxIterations(maxIterations), checkInterval(std::max(1, checkInterval)),
+    norm(norm) {}
+
+long MPIIterator::run(std::function<void (MPIIterationContext&)> step) {
+    MPIIterationContext context(this->mpi);
+    std::vector<double> seconds;
+    std::vector<double> residuals;
+    this->done = false;
+
+    while (context.iteration < this->maxIterations && !this->done) {
+        double start = MPI_Wtime();
+        step(context);
+        seconds.push_back(MPI_Wtime() - start);
+        this->mpi.traceEvent("iteration", start);
+        this->mpi.getProgress().pollPoint();
+        residuals.push_back(-1);
+
+        context.iteration++;
+        if (context.iteration % this->checkInterval == 0 || context.iteration == this->maxIterations) {
+            context.globalResidual = this->mpi.allreduce(context.residual, this->norm);
+            residuals.back() = context.globalResidual;
+            this->done = context.globalResidual <= this->tolerance;
+        }
+    }
+
+    std::vector<double> maxSeconds = this->mpi.allreduceMultiple(seconds, MPI_MAX);
+    std::vector<double> totalSeconds = this->mpi.allreduceMultiple(seconds, MPI_SUM);
+    this->stats.resize(seconds.size());
+    for (size_t i = 0; i < seconds.size(); i++) {
+        MPIIterationStats& entry = this->stats[i];
+        entry.seconds = seconds[i];
+        entry.maxSeconds = maxSeconds[i];
+        entry.meanSeconds = totalSeconds[i] / this->mpi.getSize();
+        entry.imbalance = entry.meanSeconds > 0 ? entry.maxSeconds / entry.meanSeconds : 1;
+        entry.residual = residuals[i];
+    }
+    return context.iteration;
+}
+
+bool MPIIterator::converged() {
+    return this->done;
+}
+
+const std::vector<MPIIterationStats>& MPIIterator::getStats() {
+    return this->stats;
+}
+
+void MPIIterator::report(std::string name) {
+    double total = 0;
+    double mean = 0;
+    double worst = 1;
+    double residual = -1;
+    for (const MPIIterationStats& entry : this->stats) {
+        total += entry.maxSeconds;
+        mean += entry.imbalance;
+        worst = std::max(worst, entry.imbalance);
+        if (entry.residual >= 0) {
+            residual = entry.residual;
+        }
+    }
+    if (!this->stats.empty()) {
+        mean /= this->stats.size();
+    }
+    std::ostream& out = filter_ios(this->mpi.getRank(), 0);
+    out << name << ": " << this->stats.size() << " iterations, "
+        << (this->done ? "converged" : "did not converge")
+        << " (residual " << residual << ")" << std::endl;
+    out << "  time " << std::fixed << std::setprecision(6) << total << "s, imbalance mean "
+        << std::setprecision(2) << mean << " worst " << worst << std::endl;
+    out.unsetf(std::ios::fixed);
+    out << std::setprecision(6);
+}
@@ -0,0 +1,93 @@
+#ifndef MPI_ITERATE_HPP
+#define MPI_ITERATE_HPP
+#include <functional>
+#include <vector>
+#include "mpiwrapper.hpp"
+
+/**
+ * What a step function sees on each iteration. Passed by reference, so the
+ * step can read the iteration number and report its residual without
+ * copying the wrapper.
+ */
+struct MPIIterationContext {
+    MPIWrapper& mpi;
+    long iteration;
+    double residual;
+    double globalResidual;
+
+    MPIIterationContext(MPIWrapper& mpi) : mpi(mpi), iteration(0), residual(0), globalResidual(-1) {}
+};
+
+/**
+ * Timing for one iteration across all processes.
+ */
+struct MPIIterationStats {
+    double seconds;
+    double maxSeconds;
+    double meanSeconds;
+    double imbalance;
+    double residual;
+};
+
+/**
+ * Runs a step function until the processes agree they have converged.
+ *
+ * Each step reports a local residual in the context. Every checkInterval
+ * iterations the residuals are combined with an allreduce (MPI_MAX by
+ * default), and all processes stop together once the combined residual is
+ * within tolerance. Per-iteration wall time is recorded locally and merged
+ * in a single collective once the loop ends, so collecting stats does not
+ * add a collective per iteration.
+ */
+class MPIIterator {
+private:
+    MPIWrapper& mpi;
+    double tolerance;
+    long maxIterations;
+    int checkInterval;
+    MPI_Op norm;
+    bool done = false;
+    std::vector<MPIIterationStats> stats;
+
+public:
+    /**
+     * @param mpi The wrapper to communicate through.
+     * @param tolerance The combined residual at or below which to stop.
+     * @param maxIterations The most iterations to run. Defaults to 1000.
+     * @param checkInterval How many iterations between convergence checks.
+     * Defaults to 1.
+     * @param norm How to combine residuals across processes. Defaults to
+     * MPI_MAX.
+     */
+    MPIIterator(MPIWrapper& mpi, double tolerance, long maxIterations=1000, int checkInterval=1, MPI_Op norm=MPI_MAX);
+
+    /**
+     * Runs the step function until convergence or the iteration limit. Must
+     * be called on every process.
+     * 
+     * @param step The step function, which should set context.residual.
+     * 
+     * @return The number of iterations run.
+     */
+    long run(std::function<void (MPIIterationContext&)> step);
+
+    /**
+     * @returns If the last run converged within tolerance.
+     */
+    bool converged();
+
+    /**
+     * @returns Timing for each iteration of the last run. The residual is
+     * negative for iterations where no check was made.
+     */
+    const std::vector<MPIIterationStats>& getStats();
+
+    /**
+     * Prints a summary of the last run from rank 0.
+     * 
+     * @param name The header to print above the summary.
+     */
+    void report(std::string name);
+};
+
+#endif // MPI_ITERATE_HPP
@@ -0,0 +1,115 @@
+#ifndef MPI_OP_HPP
+#define MPI_OP_HPP
+#include <mpi.h>
+#include "mpiu.hpp"
+
+/**
+ * Adapts a binary function object into a commutative MPI_Op so that it can
+ * be used with MPI's reduction collectives. The op is created once per
+ * (T, F) pair and reused; the function object itself is bound for the
+ * duration of each collective call.
+ *
+ * Because each lambda has its own type, every lambda gets its own op. Only
+ * one collective per (T, F) pair may be in flight at a time.
+ *
+ * @param T The MPI-supported type being reduced.
+ * @param F The function object type, callable as T(const T&, const T&).
+ */
+template<typename T, typename F>
+struct mpi_lambda_op {
+    static const F* current;
+
+    /**
+     * The MPI_User_function trampoline. Folds each value of in into inout.
+     */
+    static void apply(void* in, void* inout, int* len, MPI_Datatype* type) {
+        const T* a = static_cast<const T*>(in);
+        T* b = static_cast<T*>(inout);
+        for (int i = 0; i < *len; i++) {
+            b[i] = (*current)(a[i], b[i]);
+        }
+    }
+
+    /**
+     * Binds fn and returns the op that calls it.
+     *
+     * @param fn The function to reduce with. Must stay alive until the
+     * collective using the op returns.
+     *
+     * @return The commutative op.
+     */
+    static MPI_Op get(const F& fn) {
+        static MPI_Op op = create();
+        current = &fn;
+        return op;
+    }
+
+private:
+    static MPI_Op create() {
+        MPI_Op op;
+        MPI_Op_create(&apply, 1, &op);
+        return op;
+    }
+};
+
+template<typename T, typename F>
+const F* mpi_lambda_op<T, F>::current = nullptr;
+
+/**
+ * Commutative MPI_Ops for sums, minimums and maximums that combine arrays
+ * with the local reduction kernels (see mpi_simd), for reducing large arrays
+ * where MPI's own ops are not vectorized. Floating-point results match
+ * MPI_SUM, MPI_MIN and MPI_MAX element by element, since each element is
+ * still combined one pair at a time.
+ *
+ *     mpi.allreduceMultiple(values, mpi_simd_op<double>::sum());
+ *
+ * @param T The MPI-supported arithmetic type being reduced.
+ */
+template<typename T>
+struct mpi_simd_op {
+    /**
+     * @returns The op adding arrays element by element.
+     */
+    static MPI_Op sum() {
+        static MPI_Op op = create(&applySum);
+        return op;
+    }
+
+    /**
+     * @returns The op keeping the smaller of each pair of elements.
+     */
+    static MPI_Op min() {
+        static MPI_Op op = create(&applyMin);
+        return op;
+    }
+
+    /**
+     * @returns The op keeping the larger of each pair of elements.
+     */
+    static MPI_Op max() {
+        static MPI_Op op = create(&applyMax);
+        return op;
+    }
+
+private:
+    static void applySum(void* in, void* inout, int* len, MPI_Datatype* type) {
+        mpi_simd<T>::addInto(static_cast<const T*>(in), static_cast<T*>(inout), *len);
+    }
+
+    static void applyMin(void* in, void* inout, int* len, MPI_Datatype* type) {
+        mpi_simd<T>::minInto(static_cast<const T*>(in), static_cast<T*>(inout), *len);
+    }
+
+    static void applyMax(void* in, void* inout, int* len, MPI_Datatype* type) {
+        mpi_simd<T>::maxInto(static_cast<const T*>(in), static_cast<T*>(inout), *len);
+    }
+
+    static MPI_Op create(MPI_User_function* apply) {
+        MPI_Op op;
+        MPI_Op_create(apply, 1, &op);
+        return op;
+    }
+};
+
+#endif // MPI_OP_HPP
@@ -0,0 +1,95 @@
+#include "mpipool.hpp"
+#include <cstdlib>
+#include <new>
+
+MPIBufferPool::~MPIBufferPool() {
+    trim();
+}
+
+MPIBufferPool& MPIBufferPool::shared() {
+    static MPIBufferPool pool;
+    return pool;
+}
+
+int MPIBufferPool::classOf(size_t bytes) {
+    int sizeClass = 0;
+    while (((size_t)1 << (sizeClass + POOL_MIN_CLASS)) < bytes) {
+        sizeClass++;
+    }
+    return sizeClass;
+}
+
+void MPIBufferPool::setRegistered(bool registered) {
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->registered = registered;
+}
+
+void* MPIBufferPool::take(size_t bytes, int& sizeClass, bool& registered) {
+    sizeClass = classOf(bytes);
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        std::vector<Block>& blocks = this->free[sizeClass];
+        if (!blocks.empty()) {
+            Block block = blocks.back();
+            blocks.pop_back();
+            this->hits++;
+            this->cached -= (size_t)1 << (sizeClass + POOL_MIN_CLASS);
+            registered = block.registered;
+            return block.ptr;
+        }
+        this->misses++;
+        registered = this->registered;
+    }
+
+    size_t length = (size_t)1 << (sizeClass + POOL_MIN_CLASS);
+    void* ptr = nullptr;
+    if (registered) {
+        MPI_Alloc_mem(length, MPI_INFO_NULL, &ptr);
+    } else {
+        ptr = std::malloc(length);
+    }
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void MPIBufferPool::give(void* ptr, int sizeClass, bool registered) {
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->free[sizeClass].push_back(Block{ptr, registered});
+    this->cached += (size_t)1 << (sizeClass + POOL_MIN_CLASS);
+}
+
+void MPIBufferPool::trim() {
+    std::lock_guard<std::mutex> guard(this->lock);
+    int finalized;
+    MPI_Finalized(&finalized);
+    for (int i = 0; i < POOL_CLASSES; i++) {
+        for (const Block& block : this->free[i]) {
+            // MPI_Alloc_mem memory can no longer be freed once MPI is down;
+            // the process is about to exit anyway.
+            if (!block.registered) {
+                std::free(block.ptr);
+            } else if (!finalized) {
+                MPI_Free_mem(block.ptr);
+            }
+        }
+        this->free[i].clear();
+    }
+    this->cached = 0;
+}
+
+long MPIBufferPool::getHits() {
+    std::lock_guard<std::mutex> guard(this->lock);
+    return this->hits;
+}
+
+long MPIBufferPool::getMisses() {
+    std::lock_guard<std::mutex> guard(this->lock);
+    return this->misses;
+}
+
+size_t MPIBufferPool::getCachedBytes() {
+    std::lock_guard<std::mutex> guard(this->lock);
+    return this->cached;
+}
@@ -0,0 +1,232 @@
+#ifndef MPI_POOL_HPP
+#define MPI_POOL_HPP
+#include <mpi.h>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+#include "mpiview.hpp"
+
+#define POOL_MIN_CLASS 6
+#define POOL_CLASSES 40
+
+template<typename T>
+class MPIBuffer;
+
+/**
+ * A cache of receive buffers, sorted into power-of-two size classes.
+ *
+ * Buffers are handed out as MPIBuffer handles, which give the memory back to
+ * the pool when destroyed instead of freeing it, so a loop that receives
+ * similar sizes each iteration only allocates on its first pass. Buffers may
+ * optionally be allocated with MPI_Alloc_mem, which some networks can
+ * transfer to and from without staging through a registered copy.
+ *
+ * Safe to use from multiple threads.
+ */
+class MPIBufferPool {
+private:
+    struct Block {
+        void* ptr;
+        bool registered;
+    };
+
+    std::mutex lock;
+    std::vector<Block> free[POOL_CLASSES];
+    bool registered = false;
+    long hits = 0;
+    long misses = 0;
+    size_t cached = 0;
+
+    /**
+     * @returns The size class that fits the given number of bytes.
+     */
+    static int classOf(size_t bytes);
+
+public:
+    MPIBufferPool() {}
+    MPIBufferPool(const MPIBufferPool& other) = delete;
+    MPIBufferPool& operator=(const MPIBufferPool& other) = delete;
+    ~MPIBufferPool();
+
+    /**
+     * @returns The pool shared by the wrapper and the debug functions.
+     */
+    static MPIBufferPool& shared();
+
+    /**
+     * Sets whether new buffers are allocated with MPI_Alloc_mem. Buffers
+     * already cached keep the allocation they were made with.
+     *
+     * @param registered Whether to allocate with MPI_Alloc_mem.
+     */
+    void setRegistered(bool registered);
+
+    /**
+     * Takes a buffer of at least the given size, reusing a cached one when
+     * possible. Prefer acquire<T>, which returns it to the pool on its own.
+     *
+     * @param bytes The number of bytes needed.
+     * @param sizeClass Set to the buffer's size class.
+     * @param registered Set to whether the buffer came from MPI_Alloc_mem.
+     *
+     * @return The buffer.
+     */
+    void* take(size_t bytes, int& sizeClass, bool& registered);
+
+    /**
+     * Gives a buffer from take() back to the pool.
+     *
+     * @param ptr The buffer.
+     * @param sizeClass The size class take() reported.
+     * @param registered Whether the buffer came from MPI_Alloc_mem.
+     */
+    void give(void* ptr, int sizeClass, bool registered);
+
+    /**
+     * Takes a buffer with room for count values.
+     *
+     * @param count The number of values needed.
+     * @param T The element type. Values are left uninitialized.
+     *
+     * @return A handle that returns the buffer to the pool when destroyed.
+     */
+    template<typename T>
+    MPIBuffer<T> acquire(size_t count) {
+        return MPIBuffer<T>(*this, count);
+    }
+
+    /**
+     * Frees every cached buffer. Called by the wrapper before MPI is
+     * finalized, since MPI_Alloc_mem memory must be freed while MPI is up.
+     */
+    void trim();
+
+    /**
+     * @returns The number of requests served from the cache.
+     */
+    long getHits();
+
+    /**
+     * @returns The number of requests that had to allocate.
+     */
+    long getMisses();
+
+    /**
+     * @returns The number of bytes held in the cache.
+     */
+    size_t getCachedBytes();
+};
+
+/**
+ * A buffer borrowed from an MPIBufferPool. Movable but not copyable; the
+ * memory goes back to the pool when the handle is destroyed.
+ *
+ * @param T The element type. Must be trivially copyable, since values are
+ * neither constructed nor destroyed.
+ */
+template<typename T>
+class MPIBuffer {
+private:
+    MPIBufferPool* pool;
+    T* ptr;
+    size_t count;
+    int sizeClass;
+    bool registered;
+
+    void release() {
+        if (this->ptr != nullptr) {
+            this->pool->give(this->ptr, this->sizeClass, this->registered);
+            this->ptr = nullptr;
+        }
+    }
+
+public:
+    MPIBuffer() : pool(nullptr), ptr(nullptr), count(0), sizeClass(0), registered(false) {}
+
+    /**
+     * Takes a buffer with room for count values from the pool.
+     *
+     * @param pool The pool to borrow from.
+     * @param count The number of values needed.
+     */
+    MPIBuffer(MPIBufferPool& pool, size_t count) : pool(&pool), count(count) {
+        this->ptr = static_cast<T*>(pool.take(count * sizeof(T), this->sizeClass, this->registered));
+    }
+
+    MPIBuffer(MPIBuffer&& other) :
+        pool(other.pool), ptr(other.ptr), count(other.count), sizeClass(other.sizeClass), registered(other.registered) {
+        other.ptr = nullptr;
+        other.count = 0;
+    }
+
+    MPIBuffer& operator=(MPIBuffer&& other) {
+        if (this != &other) {
+            release();
+            this->pool = other.pool;
+            this->ptr = other.ptr;
+            this->count = other.count;
+            this->sizeClass = other.sizeClass;
+            this->registered = other.registered;
+            other.ptr = nullptr;
+            other.count = 0;
+        }
+        return *this;
+    }
+
+    MPIBuffer(const MPIBuffer& other) = delete;
+    MPIBuffer& operator=(const MPIBuffer& other) = delete;
+
+    ~MPIBuffer() {
+        release();
+    }
+
+    /**
+     * @returns A pointer to the first value.
+     */
+    T* data() const {
+        return this->ptr;
+    }
+
+    /**
+     * @returns The number of values in the buffer.
+     */
+    size_t size() const {
+        return this->count;
+    }
+
+    /**
+     * Changes the number of values in the buffer, moving to a larger buffer
+     * from the pool if needed. Values are not kept when moving.
+     *
+     * @param count The number of values needed.
+     */
+    void resize(size_t count) {
+        if (this->ptr != nullptr && count * sizeof(T) <= ((size_t)1 << (this->sizeClass + POOL_MIN_CLASS))) {
+            this->count = count;
+            return;
+        }
+        MPIBufferPool& from = this->pool != nullptr ? *this->pool : MPIBufferPool::shared();
+        *this = MPIBuffer<T>(from, count);
+    }
+
+    T* begin() const {
+        return this->ptr;
+    }
+
+    T* end() const {
+        return this->ptr + this->count;
+    }
+
+    T& operator[](size_t index) const {
+        return this->ptr[index];
+    }
+
+    /**
+     * @returns A view over the buffer, for the wrapper's view overloads.
+     */
+    MPIView<T> view() const {
+        return MPIView<T>(this->ptr, this->count);
+    }
+};
+
+#endif // MPI_POOL_HPP
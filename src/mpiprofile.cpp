@@ -0,0 +1,112 @@
+#include "mpiprofile.hpp"
+#include "mpiu.hpp"
+#include <algorithm>
+#include <numeric>
+
+MPIProfile::MPIProfile(int size) :
+    messagesSent(size), messagesReceived(size), bytesSent(size), bytesReceived(size) {
+    reset();
+}
+
+void MPIProfile::setEnabled(bool enabled) {
+    this->enabled = enabled;
+}
+
+void MPIProfile::recordSend(int peer, long bytes) {
+    if (peer < 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->messagesSent[peer]++;
+    this->bytesSent[peer] += bytes;
+}
+
+void MPIProfile::recordReceive(int peer, long bytes) {
+    if (peer < 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->messagesReceived[peer]++;
+    this->bytesReceived[peer] += bytes;
+}
+
+void MPIProfile::recordArrival(int peer, const MPI_Status& status) {
+    if (!isEnabled()) {
+        return;
+    }
+    int bytes;
+    MPI_Get_count(&status, MPI_BYTE, &bytes);
+    recordReceive(peer, bytes);
+}
+
+void MPIProfile::recordTime(MPIProfileCategory category, double start) {
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->seconds[category] += MPI_Wtime() - start;
+}
+
+void MPIProfile::reset() {
+    std::fill(this->messagesSent.begin(), this->messagesSent.end(), 0);
+    std::fill(this->messagesReceived.begin(), this->messagesReceived.end(), 0);
+    std::fill(this->bytesSent.begin(), this->bytesSent.end(), 0);
+    std::fill(this->bytesReceived.begin(), this->bytesReceived.end(), 0);
+    std::fill(this->seconds, this->seconds + PROFILE_CATEGORIES, 0.0);
+}
+
+long MPIProfile::getMessagesSent(int peer) const {
+    return this->messagesSent[peer];
+}
+
+long MPIProfile::getMessagesReceived(int peer) const {
+    return this->messagesReceived[peer];
+}
+
+long MPIProfile::getBytesSent(int peer) const {
+    return this->bytesSent[peer];
+}
+
+long MPIProfile::getBytesReceived(int peer) const {
+    return this->bytesReceived[peer];
+}
+
+double MPIProfile::getSeconds(MPIProfileCategory category) const {
+    return this->seconds[category];
+}
+
+void MPIProfile::report(MPI_Comm comm) {
+    int rank;
+    int size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    debug_header(rank, "Communication profile");
+    debug_table<long>(rank, size, "messages sent", std::accumulate(messagesSent.begin(), messagesSent.end(), 0L));
+    debug_table<long>(rank, size, "messages received", std::accumulate(messagesReceived.begin(), messagesReceived.end(), 0L));
+    debug_table<long>(rank, size, "bytes sent", std::accumulate(bytesSent.begin(), bytesSent.end(), 0L));
+    debug_table<long>(rank, size, "bytes received", std::accumulate(bytesReceived.begin(), bytesReceived.end(), 0L));
+    debug_table<long>(rank, size, "us in send", seconds[PROFILE_SEND] * 1e6);
+    debug_table<long>(rank, size, "us in receive", seconds[PROFILE_RECEIVE] * 1e6);
+    debug_table<long>(rank, size, "us in wait", seconds[PROFILE_WAIT] * 1e6);
+    debug_table<long>(rank, size, "us in barrier", seconds[PROFILE_BARRIER] * 1e6);
+    debug_table<long>(rank, size, "us collective", seconds[PROFILE_COLLECTIVE] * 1e6);
+
+    std::vector<long> matrix(rank == 0 ? size * size : 0);
+    MPI_Gather(bytesSent.data(), size, MPI_LONG, matrix.data(), size, MPI_LONG, 0, comm);
+    if (rank != 0) {
+        return;
+    }
+    long maxBytes = max_val_in<long>(matrix.data(), matrix.size(), 1);
+    int col_size = std::max((int)std::to_string(maxBytes).length(), (int)std::to_string(size - 1).length()) + 2;
+    int columns = size + 1;
+    std::cout << "Bytes sent (row: from, column: to)" << std::endl;
+    print_table_row("┌", "┬", "┐", "─", [](int i) -> std::string { return ""; }, columns, col_size);
+    print_table_row("│", "│", "│", " ", [](int i) -> std::string {
+        return i == 0 ? "" : std::to_string(i - 1);
+    }, columns, col_size);
+    for (int from = 0; from < size; from++) {
+        print_table_row("├", "┼", "┤", "─", [](int i) -> std::string { return ""; }, columns, col_size);
+        print_table_row("│", "│", "│", " ", [&matrix, from, size](int i) -> std::string {
+            return i == 0 ? std::to_string(from) : std::to_string(matrix[from * size + i - 1]);
+        }, columns, col_size);
+    }
+    print_table_row("└", "┴", "┘", "─", [](int i) -> std::string { return ""; }, columns, col_size);
+}
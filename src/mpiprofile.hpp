@@ -0,0 +1,127 @@
+#ifndef MPI_PROFILE_HPP
+#define MPI_PROFILE_HPP
+#include <mpi.h>
+#include <mutex>
+#include <vector>
+
+//
+// Communication Profiling
+//
+// The wrapper counts messages and bytes per peer and time spent blocked in
+// MPI calls. Collection is off until enabled at run time, either with
+// MPIWrapper::setProfiling(true) or by setting MPI_WRAPPER_PROFILE=1 in the
+// environment. Defining MPI_WRAPPER_NO_PROFILE when compiling removes it
+// entirely.
+//
+// Counters are updated under a lock, since the progress engine's thread
+// counts the receives it completes while the application communicates.
+//
+
+enum MPIProfileCategory {
+    PROFILE_SEND,
+    PROFILE_RECEIVE,
+    PROFILE_WAIT,
+    PROFILE_BARRIER,
+    PROFILE_COLLECTIVE,
+    PROFILE_CATEGORIES
+};
+
+/**
+ * Per-process communication counters.
+ */
+class MPIProfile {
+private:
+    bool enabled = false;
+    std::mutex lock;
+    std::vector<long> messagesSent;
+    std::vector<long> messagesReceived;
+    std::vector<long> bytesSent;
+    std::vector<long> bytesReceived;
+    double seconds[PROFILE_CATEGORIES];
+
+public:
+    /**
+     * @param size The number of peers to keep counters for.
+     */
+    MPIProfile(int size);
+
+    /**
+     * @returns If counters are being collected.
+     */
+    bool isEnabled() const {
+#ifdef MPI_WRAPPER_NO_PROFILE
+        return false;
+#else
+        return enabled;
+#endif
+    }
+
+    /**
+     * Turns collection on or off. Counters are kept when turned off.
+     * 
+     * @param enabled Whether to collect counters.
+     */
+    void setEnabled(bool enabled);
+
+    /**
+     * @returns The time to measure a call from, or 0 when not collecting.
+     */
+    double start() const {
+        return isEnabled() ? MPI_Wtime() : 0;
+    }
+
+    /**
+     * Counts a message sent.
+     * 
+     * @param peer The rank the message went to.
+     * @param bytes The size of the message.
+     */
+    void recordSend(int peer, long bytes);
+
+    /**
+     * Counts a message received.
+     * 
+     * @param peer The rank the message came from.
+     * @param bytes The size of the message.
+     */
+    void recordReceive(int peer, long bytes);
+
+    /**
+     * Counts a received message, taking its size from its status, if
+     * collecting.
+     * 
+     * @param peer The rank the message came from.
+     * @param status The status of the receive.
+     */
+    void recordArrival(int peer, const MPI_Status& status);
+
+    /**
+     * Adds the time since start to a category.
+     * 
+     * @param category What the time was spent on.
+     * @param start The value returned by start() before the call.
+     */
+    void recordTime(MPIProfileCategory category, double start);
+
+    /**
+     * Zeroes every counter.
+     */
+    void reset();
+
+    long getMessagesSent(int peer) const;
+    long getMessagesReceived(int peer) const;
+    long getBytesSent(int peer) const;
+    long getBytesReceived(int peer) const;
+    double getSeconds(MPIProfileCategory category) const;
+
+    /**
+     * Merges every process's counters into rank 0 and prints them as tables:
+     * totals per rank, then a matrix of bytes sent between each pair of
+     * ranks. Must be called on every process.
+     * 
+     * @param comm The communicator the counters were collected on.
+     */
+    void report(MPI_Comm comm);
+};
+
+#endif // MPI_PROFILE_HPP
@@ -0,0 +1,139 @@
+#include "mpiprogress.hpp"
+#include <chrono>
+#include <stdexcept>
+
+MPIProgress::MPIProgress(int threadLevel) : running(false), threadLevel(threadLevel) {}
+
+MPIProgress::~MPIProgress() {
+    stop();
+}
+
+void MPIProgress::add(const MPIRequestBase& request, std::function<void (MPIRequestBase&)> callback) {
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->requests.push_back(request);
+    this->callbacks.push_back(callback);
+}
+
+int MPIProgress::poll() {
+    std::vector<MPIRequestBase> done;
+    std::vector<std::function<void (MPIRequestBase&)>> toRun;
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        if (this->requests.empty()) {
+            return 0;
+        }
+        std::vector<MPI_Request> handles(this->requests.size());
+        std::vector<MPI_Status> statuses(this->requests.size());
+        std::vector<int> indices(this->requests.size());
+        for (size_t i = 0; i < this->requests.size(); i++) {
+            handles[i] = this->requests[i].getState()->request;
+        }
+        int count;
+        MPI_Testsome(handles.size(), handles.data(), &count, indices.data(), statuses.data());
+        if (count == MPI_UNDEFINED) {
+            count = 0;
+        }
+        for (int i = 0; i < count; i++) {
+            this->requests[indices[i]].getState()->complete(statuses[i]);
+        }
+
+        // Requests completed elsewhere (already null) count as done too.
+        size_t kept = 0;
+        for (size_t i = 0; i < this->requests.size(); i++) {
+            if (this->requests[i].isDone()) {
+                done.push_back(this->requests[i]);
+                toRun.push_back(this->callbacks[i]);
+                continue;
+            }
+            this->requests[kept] = this->requests[i];
+            this->callbacks[kept] = this->callbacks[i];
+            kept++;
+        }
+        this->requests.resize(kept);
+        this->callbacks.resize(kept);
+        this->callbacksRunning += done.size();
+    }
+
+    for (size_t i = 0; i < done.size(); i++) {
+        if (toRun[i]) {
+            toRun[i](done[i]);
+        }
+    }
+    if (!done.empty()) {
+        std::lock_guard<std::mutex> guard(this->lock);
+        this->completed += done.size();
+        this->callbacksRunning -= done.size();
+        this->finished.notify_all();
+    }
+    return done.size();
+}
+
+void MPIProgress::pollPoint() {
+    if (this->running || this->pollEvery == 0) {
+        return;
+    }
+    if (++this->points % this->pollEvery == 0) {
+        poll();
+    }
+}
+
+void MPIProgress::setPollEvery(int every) {
+    this->pollEvery = every;
+}
+
+void MPIProgress::waitAll() {
+    if (!this->running) {
+        while (getPending() > 0) {
+            poll();
+        }
+        return;
+    }
+    std::unique_lock<std::mutex> guard(this->lock);
+    this->finished.wait(guard, [this]() { return this->requests.empty() && this->callbacksRunning == 0; });
+}
+
+void MPIProgress::start(double interval) {
+    if (this->threadLevel < MPI_THREAD_MULTIPLE) {
+        throw std::runtime_error("a progress thread needs MPI_THREAD_MULTIPLE");
+    }
+    if (this->running) {
+        return;
+    }
+    this->interval = interval;
+    this->running = true;
+    this->thread = std::thread(&MPIProgress::loop, this);
+}
+
+void MPIProgress::stop() {
+    if (!this->running) {
+        return;
+    }
+    this->running = false;
+    this->thread.join();
+}
+
+void MPIProgress::loop() {
+    while (this->running) {
+        if (poll() == 0) {
+            if (this->interval > 0) {
+                std::this_thread::sleep_for(std::chrono::duration<double>(this->interval));
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+}
+
+bool MPIProgress::isRunning() {
+    return this->running;
+}
+
+size_t MPIProgress::getPending() {
+    std::lock_guard<std::mutex> guard(this->lock);
+    return this->requests.size() + this->callbacksRunning;
+}
+
+long MPIProgress::getCompleted() {
+    std::lock_guard<std::mutex> guard(this->lock);
+    return this->completed;
+}
@@ -0,0 +1,150 @@
+#ifndef MPI_PROGRESS_HPP
+#define MPI_PROGRESS_HPP
+#include <mpi.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "mpirequest.hpp"
+
+/**
+ * Keeps non-blocking requests moving while the application computes. Many
+ * MPI implementations only advance a large (rendezvous) transfer while the
+ * process is inside an MPI call, so a send started before a long compute
+ * phase may not move until the next wait. Requests handed to the engine are
+ * tested in batches with MPI_Testsome, either from a background thread
+ * (start) or at polling points in the application (pollPoint, which
+ * MPIWrapper::work and MPIIterator::run call between steps), and a callback
+ * runs when each one completes. Receives it completes are counted in the
+ * issuing wrapper's profile like any other.
+ *
+ * Once added, a request belongs to the engine: observe it through its
+ * callback, isDone(), or waitAll(), and do not test() or wait() it directly
+ * while the thread runs. Callbacks run on whichever thread completed the
+ * request, without the engine's lock held, so they may add more requests.
+ */
+class MPIProgress {
+private:
+    std::mutex lock;
+    std::condition_variable finished;
+    std::vector<MPIRequestBase> requests;
+    std::vector<std::function<void (MPIRequestBase&)>> callbacks;
+    std::thread thread;
+    std::atomic<bool> running;
+    double interval = 0;
+    int threadLevel;
+    int pollEvery = 1;
+    long points = 0;
+    long completed = 0;
+    // Requests taken off the list whose callbacks have not finished.
+    long callbacksRunning = 0;
+
+    /**
+     * The background thread: polls until stopped, sleeping for the interval
+     * between passes that found nothing to do.
+     */
+    void loop();
+
+public:
+    /**
+     * @param threadLevel The thread level MPI was initialized with, which
+     * decides whether a background thread is allowed.
+     */
+    MPIProgress(int threadLevel);
+
+    MPIProgress(const MPIProgress& other) = delete;
+    MPIProgress& operator=(const MPIProgress& other) = delete;
+
+    /**
+     * Stops the background thread. Requests still pending stay with the
+     * wrapper that issued them.
+     */
+    ~MPIProgress();
+
+    /**
+     * Hands a request to the engine.
+     *
+     * @param request The request to progress.
+     * @param callback Called with the request once it completes. Optional.
+     */
+    void add(const MPIRequestBase& request, std::function<void (MPIRequestBase&)> callback=nullptr);
+
+    /**
+     * Hands a typed request to the engine, with a callback that can read
+     * what it transferred.
+     *
+     * @param request The request to progress.
+     * @param callback Called with the request once it completes.
+     * @param T The type the request transfers.
+     */
+    template<typename T>
+    void add(MPIRequest<T> request, std::function<void (MPIRequest<T>&)> callback) {
+        add(static_cast<const MPIRequestBase&>(request), [request, callback](MPIRequestBase&) mutable {
+            callback(request);
+        });
+    }
+
+    /**
+     * Tests every request once with MPI_Testsome and runs the callbacks of
+     * those that completed. Does not block.
+     *
+     * @return The number of requests that completed.
+     */
+    int poll();
+
+    /**
+     * Marks a point where the application can spare time for
+     * communication. Polls on every n-th call (see setPollEvery), and does
+     * nothing while the background thread runs.
+     */
+    void pollPoint();
+
+    /**
+     * Sets how often pollPoint polls.
+     *
+     * @param every Poll on every this many calls. 1 polls on each; 0 never.
+     */
+    void setPollEvery(int every);
+
+    /**
+     * Blocks until every request has completed and its callback has run.
+     */
+    void waitAll();
+
+    /**
+     * Starts polling from a background thread. Needs MPI_THREAD_MULTIPLE,
+     * since the thread calls MPI while the application does.
+     *
+     * @param interval Seconds to sleep after a pass that completed nothing.
+     * Defaults to 0, which only yields.
+     *
+     * @throws std::runtime_error If MPI was not initialized with
+     * MPI_THREAD_MULTIPLE.
+     */
+    void start(double interval=0);
+
+    /**
+     * Stops the background thread, if running, and waits for it to exit.
+     */
+    void stop();
+
+    /**
+     * @returns If the background thread is running.
+     */
+    bool isRunning();
+
+    /**
+     * @returns The number of requests not completed yet, or whose callbacks
+     * are still running.
+     */
+    size_t getPending();
+
+    /**
+     * @returns The number of requests completed by the engine so far.
+     */
+    long getCompleted();
+};
+
+#endif // MPI_PROGRESS_HPP
@@ -0,0 +1,210 @@
+#ifndef MPI_REQUEST_HPP
+#define MPI_REQUEST_HPP
+#include <mpi.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "mpitype.hpp"
+
+/**
+ * Shared state behind a request handle. Holds the underlying MPI request and
+ * the status it completed with, so that both the handle and the wrapper that
+ * issued it can observe completion. The status is written before done is
+ * set, so a thread that sees done (such as the application while the
+ * progress engine's thread completes requests) also sees the status.
+ */
+struct MPIRequestState {
+    MPI_Request request = MPI_REQUEST_NULL;
+    MPI_Status status;
+    std::atomic<bool> done{false};
+    // Set on receives, to count the message when it arrives.
+    std::function<void (const MPI_Status&)> arrival;
+
+    virtual ~MPIRequestState() {}
+
+    /**
+     * @returns If the request was seen to complete. Does not call into MPI.
+     */
+    bool isDone() const {
+        return this->done.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Marks this request as completed with the given status, and reports the
+     * arrival of a receive.
+     *
+     * @param other The status the request completed with.
+     */
+    void complete(const MPI_Status& other) {
+        this->status = other;
+        this->request = MPI_REQUEST_NULL;
+        if (this->arrival) {
+            this->arrival(this->status);
+        }
+        this->done.store(true, std::memory_order_release);
+    }
+
+    /**
+     * @returns If the request has completed. Does not block.
+     */
+    bool test() {
+        if (!isDone()) {
+            int flag;
+            MPI_Status tmp;
+            MPI_Test(&this->request, &flag, &tmp);
+            if (flag) {
+                complete(tmp);
+            }
+        }
+        return isDone();
+    }
+
+    /**
+     * Blocks until the request has completed.
+     */
+    void wait() {
+        if (!isDone()) {
+            MPI_Status tmp;
+            MPI_Wait(&this->request, &tmp);
+            complete(tmp);
+        }
+    }
+};
+
+/**
+ * Request state that also owns the buffer being sent from or received into,
+ * so that the buffer outlives the call that started the request.
+ *
+ * @param T The MPI-supported type being transferred.
+ */
+template<typename T>
+struct MPITypedRequestState : public MPIRequestState {
+    std::vector<T> buffer;
+};
+
+/**
+ * Untyped handle to an outstanding non-blocking operation. Copies of a
+ * handle refer to the same request. Dropping a handle does not cancel the
+ * request; the wrapper that issued it keeps it alive until it completes.
+ */
+class MPIRequestBase {
+protected:
+    std::shared_ptr<MPIRequestState> state;
+
+public:
+    MPIRequestBase() {}
+    MPIRequestBase(std::shared_ptr<MPIRequestState> state) : state(state) {}
+
+    /**
+     * @returns If the request has completed. Does not block.
+     */
+    bool test() {
+        return this->state->test();
+    }
+
+    /**
+     * Blocks until the request has completed.
+     */
+    void wait() {
+        this->state->wait();
+    }
+
+    /**
+     * @returns If the request was seen to complete. Does not call into MPI.
+     */
+    bool isDone() const {
+        return this->state->isDone();
+    }
+
+    /**
+     * @returns The status the request completed with. Only meaningful once
+     * the request is done.
+     */
+    MPI_Status getStatus() const {
+        return this->state->status;
+    }
+
+    /**
+     * @returns The source of a completed receive.
+     */
+    int getSource() const {
+        return this->state->status.MPI_SOURCE;
+    }
+
+    /**
+     * @returns The tag of a completed receive.
+     */
+    int getTag() const {
+        return this->state->status.MPI_TAG;
+    }
+
+    /**
+     * @returns The shared state backing this handle.
+     */
+    std::shared_ptr<MPIRequestState> getState() const {
+        return this->state;
+    }
+};
+
+/**
+ * Typed handle to an outstanding non-blocking send or receive. Acts as a
+ * future: get() waits for the request and returns the transferred value.
+ *
+ * @param T The MPI-supported type being transferred.
+ */
+template<typename T>
+class MPIRequest : public MPIRequestBase {
+private:
+    MPITypedRequestState<T>* typed() const {
+        return static_cast<MPITypedRequestState<T>*>(this->state.get());
+    }
+
+public:
+    MPIRequest() {}
+    MPIRequest(std::shared_ptr<MPITypedRequestState<T>> state) : MPIRequestBase(state) {}
+
+    /**
+     * Waits for the request, then returns the first value transferred. Only
+     * valid on receives and on single-value isend, since sends made directly
+     * from caller storage keep no copy of the values.
+     *
+     * @return The value that was sent or received.
+     *
+     * @throws std::runtime_error If the request holds no values, as for a
+     * send from caller storage or a receive of zero values.
+     */
+    T get() {
+        wait();
+        if (typed()->buffer.empty()) {
+            throw std::runtime_error("get() on a request that holds no values");
+        }
+        return typed()->buffer[0];
+    }
+
+    /**
+     * Waits for the request, then returns every value transferred. Empty for
+     * sends made directly from caller storage.
+     *
+     * @return The values that were sent or received.
+     */
+    const std::vector<T>& getAll() {
+        wait();
+        return typed()->buffer;
+    }
+
+    /**
+     * Waits for the request, then returns the number of values received.
+     *
+     * @return The number of values in the completed receive.
+     */
+    int getCount() {
+        wait();
+        int count;
+        MPI_Get_count(&this->state->status, mpi_type<T>::get(), &count);
+        return count;
+    }
+};
+
+#endif // MPI_REQUEST_HPP
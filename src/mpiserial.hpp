@@ -0,0 +1,372 @@
+#ifndef MPI_SERIAL_HPP
+#define MPI_SERIAL_HPP
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+//
+// Serialization
+//
+// Turns values that mpi_type cannot describe, such as strings, nested
+// vectors, maps and user types, into one flat buffer of bytes, and back.
+// Scalars are written as their raw bytes, and every container is written as
+// a 64-bit element count followed by its elements, so a whole message can be
+// read back from the one buffer with no size sent ahead of it. Both sides
+// must run the same binary layout (the same machine type).
+//
+// User types opt in either with a member
+//
+//     template<typename A>
+//     void serialize(A& archive) {
+//         archive(name, position, neighbors);
+//     }
+//
+// or, for types that cannot be changed, a specialization of mpi_serial with
+// a static visit(A& archive, T& value). Either is used for both directions.
+//
+
+template<typename T, typename Enable=void>
+struct mpi_serial {
+    template<typename A>
+    static void visit(A& archive, T& value) {
+        value.serialize(archive);
+    }
+};
+
+/**
+ * Whether values of a type are written as their raw bytes, which lets
+ * vectors of them be copied in one block.
+ */
+template<typename T>
+struct mpi_serial_raw {
+    static const bool value = std::is_arithmetic<T>::value || std::is_enum<T>::value;
+};
+
+template<typename T>
+struct mpi_serial<T, typename std::enable_if<mpi_serial_raw<T>::value>::type> {
+    template<typename A>
+    static void visit(A& archive, T& value) {
+        archive.bytes(&value, sizeof(T));
+    }
+};
+
+/**
+ * Writes values into a growing byte buffer. Passed to serialize members and
+ * mpi_serial specializations, which should use it only through
+ * operator() / operator&, bytes() and length().
+ */
+class MPISerializer {
+private:
+    std::vector<char> buffer;
+
+public:
+    static const bool loading = false;
+
+    /**
+     * Appends raw bytes.
+     *
+     * @param data The bytes to append.
+     * @param count The number of bytes.
+     */
+    void bytes(const void* data, size_t count) {
+        const char* first = static_cast<const char*>(data);
+        this->buffer.insert(this->buffer.end(), first, first + count);
+    }
+
+    /**
+     * Writes the element count of a container.
+     *
+     * @param count The count to write.
+     * @param unit Unused; see MPIDeserializer::length.
+     */
+    void length(size_t& count, size_t unit=0) {
+        uint64_t wire = count;
+        bytes(&wire, sizeof(wire));
+    }
+
+    template<typename T>
+    MPISerializer& operator&(const T& value) {
+        // Serializing only reads the value, whichever way visit is written.
+        mpi_serial<T>::visit(*this, const_cast<T&>(value));
+        return *this;
+    }
+
+    void operator()() {}
+
+    template<typename T, typename... R>
+    void operator()(const T& value, const R&... rest) {
+        *this & value;
+        (*this)(rest...);
+    }
+
+    /**
+     * @returns The bytes written so far.
+     */
+    const char* data() const {
+        return this->buffer.data();
+    }
+
+    /**
+     * @returns The number of bytes written so far.
+     */
+    size_t size() const {
+        return this->buffer.size();
+    }
+
+    /**
+     * Makes room for bytes to be written without reallocating.
+     *
+     * @param count The number of bytes to make room for.
+     */
+    void reserve(size_t count) {
+        this->buffer.reserve(count);
+    }
+
+    /**
+     * Empties the buffer, keeping its memory for the next message.
+     */
+    void clear() {
+        this->buffer.clear();
+    }
+};
+
+/**
+ * Reads values back out of a byte buffer written by MPISerializer, in the
+ * same order they were written.
+ */
+class MPIDeserializer {
+private:
+    const char* buffer;
+    size_t count;
+    size_t position = 0;
+
+public:
+    static const bool loading = true;
+
+    /**
+     * @param data The serialized bytes, which must outlive the reader.
+     * @param count The number of bytes.
+     */
+    MPIDeserializer(const char* data, size_t count) : buffer(data), count(count) {}
+
+    /**
+     * Copies out raw bytes.
+     *
+     * @param data Where to copy the bytes to.
+     * @param count The number of bytes.
+     *
+     * @throws std::runtime_error If the buffer runs out first.
+     */
+    void bytes(void* data, size_t count) {
+        if (count > remaining()) {
+            throw std::runtime_error("serialized data ended early");
+        }
+        std::memcpy(data, this->buffer + this->position, count);
+        this->position += count;
+    }
+
+    /**
+     * Reads the element count of a container.
+     *
+     * @param count Set to the count.
+     * @param unit The fewest bytes each element takes, to reject counts the
+     * rest of the buffer cannot hold before allocating for them. Defaults
+     * to 0, for no check.
+     *
+     * @throws std::runtime_error If the count cannot be right.
+     */
+    void length(size_t& count, size_t unit=0) {
+        uint64_t wire;
+        bytes(&wire, sizeof(wire));
+        if (unit > 0 && wire > remaining() / unit) {
+            throw std::runtime_error("serialized length is larger than the data");
+        }
+        count = wire;
+    }
+
+    template<typename T>
+    MPIDeserializer& operator&(T& value) {
+        mpi_serial<T>::visit(*this, value);
+        return *this;
+    }
+
+    void operator()() {}
+
+    template<typename T, typename... R>
+    void operator()(T& value, R&... rest) {
+        *this & value;
+        (*this)(rest...);
+    }
+
+    /**
+     * @returns The number of bytes not read yet.
+     */
+    size_t remaining() const {
+        return this->count - this->position;
+    }
+};
+
+template<typename C, typename T, typename A>
+struct mpi_serial<std::basic_string<C, T, A>> {
+    template<typename R>
+    static void visit(R& archive, std::basic_string<C, T, A>& value) {
+        size_t count = value.size();
+        archive.length(count, sizeof(C));
+        value.resize(count);
+        if (count > 0) {
+            archive.bytes(&value[0], count * sizeof(C));
+        }
+    }
+};
+
+template<typename T, typename A>
+struct mpi_serial<std::vector<T, A>> {
+    template<typename R>
+    static void visit(R& archive, std::vector<T, A>& values) {
+        size_t count = values.size();
+        // Other elements take at least a byte each, which is enough to
+        // reject a corrupt count before resizing for it.
+        archive.length(count, mpi_serial_raw<T>::value ? sizeof(T) : 1);
+        values.resize(count);
+        if (mpi_serial_raw<T>::value) {
+            if (count > 0) {
+                archive.bytes(values.data(), count * sizeof(T));
+            }
+            return;
+        }
+        for (T& value : values) {
+            archive & value;
+        }
+    }
+};
+
+template<typename A>
+struct mpi_serial<std::vector<bool, A>> {
+    template<typename R>
+    static void visit(R& archive, std::vector<bool, A>& values) {
+        size_t count = values.size();
+        archive.length(count, 1);
+        values.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            bool value = values[i];
+            archive & value;
+            if (R::loading) {
+                values[i] = value;
+            }
+        }
+    }
+};
+
+template<typename T, size_t N>
+struct mpi_serial<std::array<T, N>> {
+    template<typename R>
+    static void visit(R& archive, std::array<T, N>& values) {
+        for (T& value : values) {
+            archive & value;
+        }
+    }
+};
+
+template<typename F, typename S>
+struct mpi_serial<std::pair<F, S>> {
+    template<typename R>
+    static void visit(R& archive, std::pair<F, S>& value) {
+        archive & value.first & value.second;
+    }
+};
+
+/**
+ * Visits an associative container as a count followed by its entries. Keys
+ * are read into a temporary and moved in, since a container's keys cannot be
+ * changed in place.
+ *
+ * @param M The container type.
+ * @param E The entry type to read and write, such as std::pair<K, V>.
+ */
+template<typename M, typename E>
+struct mpi_serial_entries {
+    static void visit(MPISerializer& archive, M& values) {
+        size_t count = values.size();
+        archive.length(count);
+        for (const auto& entry : values) {
+            archive & entry;
+        }
+    }
+
+    static void visit(MPIDeserializer& archive, M& values) {
+        size_t count;
+        archive.length(count);
+        values.clear();
+        for (size_t i = 0; i < count; i++) {
+            E entry;
+            archive & entry;
+            values.insert(values.end(), std::move(entry));
+        }
+    }
+};
+
+template<typename K, typename V, typename C, typename A>
+struct mpi_serial<std::map<K, V, C, A>> : mpi_serial_entries<std::map<K, V, C, A>, std::pair<K, V>> {};
+
+template<typename K, typename V, typename H, typename Q, typename A>
+struct mpi_serial<std::unordered_map<K, V, H, Q, A>> :
+    mpi_serial_entries<std::unordered_map<K, V, H, Q, A>, std::pair<K, V>> {};
+
+template<typename K, typename C, typename A>
+struct mpi_serial<std::set<K, C, A>> : mpi_serial_entries<std::set<K, C, A>, K> {};
+
+// The writer only reads what it visits, so a const pair key is visited as
+// its non-const self.
+template<typename F, typename S>
+struct mpi_serial<std::pair<const F, S>> {
+    template<typename R>
+    static void visit(R& archive, std::pair<const F, S>& value) {
+        archive & value.first & value.second;
+    }
+};
+
+/**
+ * Serializes a value into a new buffer.
+ *
+ * @param value The value to write.
+ *
+ * @return The serializer holding the bytes.
+ */
+template<typename T>
+MPISerializer mpi_serialize(const T& value) {
+    MPISerializer out;
+    out & value;
+    return out;
+}
+
+/**
+ * Reads a value back out of a buffer that holds exactly one serialized
+ * value.
+ *
+ * @param data The serialized bytes.
+ * @param count The number of bytes.
+ *
+ * @return The value.
+ *
+ * @throws std::runtime_error If the bytes do not hold exactly one T.
+ */
+template<typename T>
+T mpi_deserialize(const char* data, size_t count) {
+    MPIDeserializer in(data, count);
+    T value;
+    in & value;
+    if (in.remaining() != 0) {
+        throw std::runtime_error("serialized data has bytes left over");
+    }
+    return value;
+}
+
+#endif // MPI_SERIAL_HPP
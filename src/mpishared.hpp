@@ -0,0 +1,183 @@
+#ifndef MPI_SHARED_HPP
+#define MPI_SHARED_HPP
+#include <mpi.h>
+#include <type_traits>
+
+/**
+ * An array of values in memory shared by every process of a node, made by
+ * MPIWrapper::allocateShared or shareTable. Each process owns one segment,
+ * which may be empty, and can read and write every other process's segment
+ * on the node directly through at(), without sending anything.
+ *
+ * The segments stay open for access for as long as the array lives, so
+ * ordering between processes is up to the caller: fence() after writing
+ * makes the writes visible to the other processes, and barrier() also waits
+ * for them to get there. Movable but not copyable; freeing the array is
+ * collective over the node, and happens on destruction.
+ *
+ * @param T The type of the values. Must be trivially copyable, since the
+ * memory is shared between address spaces.
+ */
+template<typename T>
+class MPISharedArray {
+private:
+    static_assert(std::is_trivially_copyable<T>::value, "shared values must be trivially copyable");
+
+    MPI_Comm comm;
+    MPI_Win window;
+    T* base;
+    long count;
+
+public:
+    MPISharedArray() : comm(MPI_COMM_NULL), window(MPI_WIN_NULL), base(nullptr), count(0) {}
+
+    /**
+     * Allocates this process's segment. Must be called on every process of
+     * the communicator.
+     *
+     * @param comm The processes to share with, all on one node, such as
+     * MPIWrapper::getNode().getComm().
+     * @param count The number of values in this process's segment.
+     */
+    MPISharedArray(MPI_Comm comm, long count) : comm(comm), base(nullptr), count(count) {
+        MPI_Info info;
+        MPI_Info_create(&info);
+        // Let each segment be placed near its owner rather than packed
+        // into one contiguous run.
+        MPI_Info_set(info, "alloc_shared_noncontig", "true");
+        MPI_Win_allocate_shared(count * sizeof(T), sizeof(T), info, comm, &this->base, &this->window);
+        MPI_Info_free(&info);
+        MPI_Win_lock_all(MPI_MODE_NOCHECK, this->window);
+    }
+
+    MPISharedArray(MPISharedArray&& other) :
+        comm(other.comm), window(other.window), base(other.base), count(other.count) {
+        other.window = MPI_WIN_NULL;
+        other.base = nullptr;
+        other.count = 0;
+    }
+
+    MPISharedArray& operator=(MPISharedArray&& other) {
+        if (this != &other) {
+            free();
+            this->comm = other.comm;
+            this->window = other.window;
+            this->base = other.base;
+            this->count = other.count;
+            other.window = MPI_WIN_NULL;
+            other.base = nullptr;
+            other.count = 0;
+        }
+        return *this;
+    }
+
+    MPISharedArray(const MPISharedArray& other) = delete;
+    MPISharedArray& operator=(const MPISharedArray& other) = delete;
+
+    ~MPISharedArray() {
+        free();
+    }
+
+    /**
+     * Releases the memory. Must be called on every process of the node;
+     * afterwards the array is empty.
+     */
+    void free() {
+        int finalized;
+        MPI_Finalized(&finalized);
+        if (this->window != MPI_WIN_NULL && !finalized) {
+            MPI_Win_unlock_all(this->window);
+            MPI_Win_free(&this->window);
+        }
+        this->window = MPI_WIN_NULL;
+        this->base = nullptr;
+        this->count = 0;
+    }
+
+    /**
+     * @returns This process's segment.
+     */
+    T* data() {
+        return this->base;
+    }
+
+    /**
+     * @returns The number of values in this process's segment.
+     */
+    long size() const {
+        return this->count;
+    }
+
+    T* begin() {
+        return this->base;
+    }
+
+    T* end() {
+        return this->base + this->count;
+    }
+
+    T& operator[](long index) {
+        return this->base[index];
+    }
+
+    /**
+     * Finds another process's segment, to read or write directly.
+     *
+     * @param rank The process's rank on the node.
+     * @param count Set to the number of values in the segment.
+     *
+     * @return The start of the segment, in this process's address space.
+     *
+     * @order O(1), no communication.
+     */
+    T* at(int rank, long& count) {
+        MPI_Aint bytes;
+        int unit;
+        T* pointer;
+        MPI_Win_shared_query(this->window, rank, &bytes, &unit, &pointer);
+        count = bytes / sizeof(T);
+        return pointer;
+    }
+
+    /**
+     * Finds another process's segment, to read or write directly.
+     *
+     * @param rank The process's rank on the node.
+     *
+     * @return The start of the segment, in this process's address space.
+     */
+    T* at(int rank) {
+        long count;
+        return at(rank, count);
+    }
+
+    /**
+     * Makes this process's writes to shared memory visible to the other
+     * processes, and theirs visible here once they fence too. A memory
+     * barrier only; it does not wait for anyone.
+     */
+    void fence() {
+        MPI_Win_sync(this->window);
+    }
+
+    /**
+     * Fences, waits for every process of the node to fence, and fences
+     * again, so that everything written before the barrier on any process
+     * can be read after it on every process. Must be called on every
+     * process of the node.
+     */
+    void barrier() {
+        MPI_Win_sync(this->window);
+        MPI_Barrier(this->comm);
+        MPI_Win_sync(this->window);
+    }
+
+    /**
+     * @returns The window behind the array, for other one-sided operations.
+     */
+    MPI_Win getWindow() const {
+        return this->window;
+    }
+};
+
+#endif // MPI_SHARED_HPP
@@ -0,0 +1,225 @@
+#ifndef MPI_SORT_HPP
+#define MPI_SORT_HPP
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include "mpicube.hpp"
+#include "mpivector.hpp"
+#include "mpiwrapper.hpp"
+
+//
+// Distributed Sorting
+//
+// Sorts values spread across processes so that each process's values are in
+// order and every value on a process comes no later than any value on the
+// next rank. Both sorts finish with block_rebalance, so each process ends
+// with a standard block of the sorted whole.
+//
+
+#define SORT_TAG 0x5300
+
+/**
+ * Orders values by a key extracted from each, for sorting by a field.
+ *
+ * @param K The key function type, callable as key(const T&). Its result
+ * must support operator<.
+ */
+template<typename K>
+struct mpi_key_less {
+    K key;
+
+    template<typename T>
+    bool operator()(const T& a, const T& b) const {
+        return key(a) < key(b);
+    }
+};
+
+/**
+ * Makes a comparator that orders values by a key.
+ *
+ *     sample_sort(mpi, particles, by_key([](const Particle& p) { return p.x; }));
+ *
+ * @param key Extracts the key to sort by from a value.
+ *
+ * @return The comparator.
+ */
+template<typename K>
+mpi_key_less<K> by_key(K key) {
+    return mpi_key_less<K>{key};
+}
+
+/**
+ * Merges sorted runs laid end to end into one sorted run, pairing up
+ * neighboring runs until one is left.
+ *
+ * @param values The runs, replaced by the merged result.
+ * @param bounds Where each run starts, followed by the end of the last.
+ * @param compare The order the runs are sorted in.
+ *
+ * @order O(n log r) for r runs.
+ */
+template<typename T, typename C>
+void merge_runs(std::vector<T>& values, std::vector<size_t> bounds, C compare) {
+    while (bounds.size() > 2) {
+        std::vector<size_t> merged;
+        for (size_t i = 0; i + 2 < bounds.size(); i += 2) {
+            std::inplace_merge(values.begin() + bounds[i], values.begin() + bounds[i + 1],
+                values.begin() + bounds[i + 2], compare);
+            merged.push_back(bounds[i]);
+        }
+        if (bounds.size() % 2 == 0) {
+            merged.push_back(bounds[bounds.size() - 2]);
+        }
+        merged.push_back(bounds.back());
+        bounds.swap(merged);
+    }
+}
+
+/**
+ * Sorts values across every process by regular sampling. Each process sorts
+ * its values and offers p evenly spaced samples; every process sorts all the
+ * samples and picks the same p - 1 splitters from them; then one
+ * alltoallMultiple sends each value to the process whose range it falls in,
+ * where the sorted runs are merged.
+ *
+ * @param mpi The wrapper to sort across.
+ * @param values This process's values, replaced by its block of the result.
+ * @param compare The order to sort in. Defaults to operator<.
+ * @param T The MPI-supported type to sort.
+ *
+ * @order O((n / p) log n + p^2 log p), one all-to-all exchange.
+ */
+template<typename T, typename C=std::less<T>>
+void sample_sort(MPIWrapper& mpi, std::vector<T>& values, C compare=C()) {
+    int size = mpi.getSize();
+    std::sort(values.begin(), values.end(), compare);
+    if (size == 1) {
+        return;
+    }
+
+    std::vector<T> samples;
+    for (int i = 0; i < size && !values.empty(); i++) {
+        samples.push_back(values[i * values.size() / size]);
+    }
+    std::vector<T> allSamples = mpi.allgatherMultiple<T>(samples);
+    std::sort(allSamples.begin(), allSamples.end(), compare);
+
+    std::vector<std::vector<T>> outgoing(size);
+    typename std::vector<T>::iterator from = values.begin();
+    for (int i = 0; i < size; i++) {
+        typename std::vector<T>::iterator to = values.end();
+        if (i < size - 1 && !allSamples.empty()) {
+            const T& splitter = allSamples[(i + 1) * allSamples.size() / size];
+            to = std::upper_bound(from, values.end(), splitter, compare);
+        }
+        outgoing[i].assign(from, to);
+        from = to;
+    }
+
+    std::vector<std::vector<T>> incoming = mpi.alltoallMultiple<T>(outgoing);
+    values.clear();
+    std::vector<size_t> bounds(1, 0);
+    for (const std::vector<T>& part : incoming) {
+        values.insert(values.end(), part.begin(), part.end());
+        bounds.push_back(values.size());
+    }
+    merge_runs(values, bounds, compare);
+    block_rebalance<T>(mpi, values);
+}
+
+/**
+ * Sorts a distributed vector by regular sampling, leaving it in block
+ * layout.
+ *
+ * @param values The vector to sort.
+ * @param compare The order to sort in. Defaults to operator<.
+ * @param T The MPI-supported type to sort.
+ */
+template<typename T, typename C=std::less<T>>
+void sample_sort(DistributedVector<T>& values, C compare=C()) {
+    values.redistribute(LAYOUT_BLOCK);
+    sample_sort<T>(values.getWrapper(), values.local(), compare);
+}
+
+/**
+ * Sorts values across every process with hypercube quicksort. Working from
+ * the highest cube dimension down, each subcube agrees on a pivot (the
+ * median of its processes' medians), and each process swaps the values on
+ * the wrong side of the pivot with its partner across that dimension
+ * (getCubeRank). After the last dimension every process holds its own
+ * range. When the number of processes is not a power of two, the processes
+ * past the cube hand their values to a partner inside it first.
+ *
+ * @param mpi The wrapper to sort across.
+ * @param values This process's values, replaced by its block of the result.
+ * @param compare The order to sort in. Defaults to operator<.
+ * @param T The MPI-supported type to sort.
+ *
+ * @order O((n / p) log n) expected, log p exchanges with one partner each.
+ */
+template<typename T, typename C=std::less<T>>
+void cube_quicksort(MPIWrapper& mpi, std::vector<T>& values, C compare=C()) {
+    int rank = mpi.getRank();
+    int size = mpi.getSize();
+    int span = cube_span(size);
+
+    if (rank >= span) {
+        mpi.sendMultiple<T>(values, rank - span, SORT_TAG);
+        values.clear();
+    } else if (rank + span < size) {
+        std::vector<T> extra;
+        mpi.receiveMultiple<T>(extra, rank + span, SORT_TAG);
+        values.insert(values.end(), extra.begin(), extra.end());
+    }
+    std::sort(values.begin(), values.end(), compare);
+
+    std::vector<T> medians;
+    std::vector<T> incoming;
+    for (int d = cube_dimensions(size) - 1; d >= 0 && rank < span; d--) {
+        // Gather the medians of this subcube, which spans dimensions 0
+        // through d, by exchanging along each of them in turn.
+        medians.clear();
+        if (!values.empty()) {
+            medians.push_back(values[values.size() / 2]);
+        }
+        for (int k = 0; k <= d; k++) {
+            cube_exchange<T>(mpi, mpi.getCubeRank(k), medians, incoming, SORT_TAG + 1);
+            medians.insert(medians.end(), incoming.begin(), incoming.end());
+        }
+
+        int partner = mpi.getCubeRank(d);
+        bool lower = rank < partner;
+        typename std::vector<T>::iterator split = values.end();
+        if (!medians.empty()) {
+            std::sort(medians.begin(), medians.end(), compare);
+            split = std::upper_bound(values.begin(), values.end(), medians[medians.size() / 2], compare);
+        }
+        std::vector<T> outgoing = lower ? std::vector<T>(split, values.end()) : std::vector<T>(values.begin(), split);
+        if (lower) {
+            values.erase(split, values.end());
+        } else {
+            values.erase(values.begin(), split);
+        }
+        cube_exchange<T>(mpi, partner, outgoing, incoming, SORT_TAG + 2);
+        size_t middle = values.size();
+        values.insert(lower ? values.end() : values.begin(), incoming.begin(), incoming.end());
+        std::inplace_merge(values.begin(), values.begin() + (lower ? middle : incoming.size()), values.end(), compare);
+    }
+    block_rebalance<T>(mpi, values);
+}
+
+/**
+ * Sorts a distributed vector with hypercube quicksort, leaving it in block
+ * layout.
+ *
+ * @param values The vector to sort.
+ * @param compare The order to sort in. Defaults to operator<.
+ * @param T The MPI-supported type to sort.
+ */
+template<typename T, typename C=std::less<T>>
+void cube_quicksort(DistributedVector<T>& values, C compare=C()) {
+    values.redistribute(LAYOUT_BLOCK);
+    cube_quicksort<T>(values.getWrapper(), values.local(), compare);
+}
+
+#endif // MPI_SORT_HPP
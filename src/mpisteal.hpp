@@ -0,0 +1,224 @@
+#ifndef MPI_STEAL_HPP
+#define MPI_STEAL_HPP
+#include <array>
+#include <deque>
+#include <functional>
+#include <vector>
+#include "mpiwrapper.hpp"
+
+#define STEAL_REQUEST_TAG 0x5700
+#define STEAL_REPLY_TAG 0x5701
+#define STEAL_TOKEN_TAG 0x5702
+#define STEAL_DONE_TAG 0x5703
+
+/**
+ * A distributed task pool with work stealing.
+ *
+ * Each process keeps a local deque of tasks and runs them newest-first. A
+ * process that runs dry asks a random victim (getRandomRank) for work, and
+ * the victim hands over the older half of its deque. Steal requests are
+ * serviced between tasks by polling hasData, so handlers should be short or
+ * push subtasks rather than running long.
+ *
+ * The pool finishes once every process is out of work and no tasks are in
+ * flight, detected with Dijkstra and Safra's token ring: a token travels the
+ * ring summing how many task batches each process has sent minus received,
+ * and rank 0 declares the pool finished once a clean lap sums to zero.
+ *
+ * The pool can be run from inside a work function; run() is collective and
+ * returns on every process at the same time.
+ *
+ * @param T The MPI-supported task type. Use MAKE_MPI_STRUCT_TYPE for
+ * structured tasks.
+ */
+template<typename T>
+class MPITaskPool {
+private:
+    MPIWrapper& mpi;
+    std::function<void (const T&, MPITaskPool<T>&)> handler;
+    std::deque<T> tasks;
+    int pollInterval;
+    long executed = 0;
+    long stealsSent = 0;
+    long stealsWon = 0;
+
+    // Safra's termination detection.
+    long counter = 0;
+    bool black = false;
+    bool holdingToken = false;
+    bool probing = false;
+    std::array<long, 2> token;
+
+    bool waiting = false;
+    bool finished = false;
+
+    void answerSteal() {
+        int thief = mpi.getLastSource();
+        mpi.receive<int>(thief, STEAL_REQUEST_TAG);
+        std::vector<T> loot(tasks.begin(), tasks.begin() + tasks.size() / 2);
+        tasks.erase(tasks.begin(), tasks.begin() + loot.size());
+        if (!loot.empty()) {
+            counter++;
+        }
+        mpi.sendMultiple<T>(loot, thief, STEAL_REPLY_TAG);
+    }
+
+    void receiveLoot() {
+        std::vector<T> loot;
+        mpi.receiveMultiple<T>(loot, mpi.getLastSource(), STEAL_REPLY_TAG);
+        waiting = false;
+        if (!loot.empty()) {
+            counter--;
+            black = true;
+            stealsWon++;
+            tasks.insert(tasks.end(), loot.begin(), loot.end());
+        }
+    }
+
+    void service() {
+        while (mpi.hasData(MPI_ANY_SOURCE, STEAL_REQUEST_TAG)) {
+            answerSteal();
+        }
+        if (waiting && mpi.hasData(MPI_ANY_SOURCE, STEAL_REPLY_TAG)) {
+            receiveLoot();
+        }
+        if (mpi.hasData(mpi.getPrevRank(), STEAL_TOKEN_TAG)) {
+            token = mpi.receive<std::array<long, 2>>(mpi.getPrevRank(), STEAL_TOKEN_TAG);
+            holdingToken = true;
+        }
+        if (mpi.hasData(0, STEAL_DONE_TAG)) {
+            mpi.receive<int>(0, STEAL_DONE_TAG);
+            finished = true;
+        }
+    }
+
+    void passToken() {
+        if (mpi.getRank() != 0) {
+            token[0] += counter;
+            token[1] |= black;
+            black = false;
+            holdingToken = false;
+            mpi.sendRing(token, STEAL_TOKEN_TAG);
+            return;
+        }
+        if (probing && token[1] == 0 && !black && token[0] + counter == 0) {
+            for (int i = 1; i < mpi.getSize(); i++) {
+                mpi.send<int>(0, i, STEAL_DONE_TAG);
+            }
+            finished = true;
+            return;
+        }
+        token[0] = 0;
+        token[1] = 0;
+        black = false;
+        probing = true;
+        holdingToken = false;
+        mpi.sendRing(token, STEAL_TOKEN_TAG);
+    }
+
+    void shutdown() {
+        // Idle processes may still have steal requests out. Keep answering
+        // (with nothing) until every process has heard back, so that no
+        // message is left unmatched.
+        while (waiting) {
+            service();
+        }
+        MPI_Request barrier;
+        MPI_Ibarrier(mpi.getComm(), &barrier);
+        int done = 0;
+        while (!done) {
+            while (mpi.hasData(MPI_ANY_SOURCE, STEAL_REQUEST_TAG)) {
+                answerSteal();
+            }
+            MPI_Test(&barrier, &done, MPI_STATUS_IGNORE);
+        }
+    }
+
+public:
+    /**
+     * @param mpi The wrapper to communicate through.
+     * @param handler Runs one task. May push more tasks onto the pool.
+     * @param pollInterval How many tasks to run between checks for steal
+     * requests. Defaults to 1.
+     */
+    MPITaskPool(MPIWrapper& mpi, std::function<void (const T&, MPITaskPool<T>&)> handler, int pollInterval=1) :
+        mpi(mpi), handler(handler), pollInterval(pollInterval) {}
+
+    /**
+     * Adds a task to this process's deque.
+     *
+     * @param task The task to add.
+     */
+    void push(const T& task) {
+        tasks.push_back(task);
+    }
+
+    /**
+     * Runs tasks, stealing when out, until no process has work left. Must be
+     * called on every process.
+     */
+    void run() {
+        counter = 0;
+        black = false;
+        probing = false;
+        waiting = false;
+        finished = false;
+        holdingToken = mpi.getRank() == 0;
+
+        while (!finished) {
+            service();
+            for (int i = 0; i < pollInterval && !tasks.empty(); i++) {
+                T task = tasks.back();
+                tasks.pop_back();
+                handler(task, *this);
+                executed++;
+            }
+            if (!tasks.empty() || finished) {
+                continue;
+            }
+            if (mpi.getSize() == 1) {
+                finished = true;
+                break;
+            }
+            if (!waiting) {
+                mpi.send<int>(0, mpi.getRandomRank(), STEAL_REQUEST_TAG);
+                stealsSent++;
+                waiting = true;
+            }
+            if (holdingToken) {
+                passToken();
+            }
+        }
+        shutdown();
+    }
+
+    /**
+     * @returns The number of tasks this process has run.
+     */
+    long getExecuted() {
+        return executed;
+    }
+
+    /**
+     * @returns The number of steal requests this process has sent.
+     */
+    long getStealsSent() {
+        return stealsSent;
+    }
+
+    /**
+     * @returns The number of steal requests that brought back work.
+     */
+    long getStealsWon() {
+        return stealsWon;
+    }
+
+    /**
+     * @returns The number of tasks waiting in this process's deque.
+     */
+    size_t getPending() {
+        return tasks.size();
+    }
+};
+
+#endif // MPI_STEAL_HPP
@@ -0,0 +1,180 @@
+#include "mpitrace.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#define TRACE_SYNC_ROUNDS 8
+
+namespace {
+    /**
+     * @returns A small id for the calling thread, numbered in the order
+     * threads first record.
+     */
+    int thread_id() {
+        static std::atomic<int> threads(0);
+        static thread_local int id = threads++;
+        return id;
+    }
+
+    std::string escape(const char* text) {
+        std::string escaped;
+        for (const char* c = text; *c; c++) {
+            if (*c == '"' || *c == '\\') {
+                escaped += '\\';
+            }
+            escaped += *c;
+        }
+        return escaped;
+    }
+}
+
+MPITrace::MPITrace(size_t capacity) : capacity(1), next(0) {
+    while (this->capacity < capacity) {
+        this->capacity <<= 1;
+    }
+}
+
+void MPITrace::setPath(std::string path) {
+    this->path = path;
+    this->enabled = !path.empty();
+    if (this->enabled && this->events.empty()) {
+        this->events.resize(this->capacity);
+    }
+}
+
+const std::string& MPITrace::getPath() const {
+    return this->path;
+}
+
+void MPITrace::record(const char* name, double start, double end, int peer, long bytes) {
+    unsigned long slot = this->next.fetch_add(1, std::memory_order_relaxed);
+    MPITraceEvent& event = this->events[slot & (this->events.size() - 1)];
+    event.name = name;
+    event.start = start;
+    event.end = end;
+    event.thread = thread_id();
+    event.peer = peer;
+    event.bytes = bytes;
+}
+
+unsigned long MPITrace::getRecorded() const {
+    return this->next.load();
+}
+
+unsigned long MPITrace::getDropped() const {
+    unsigned long recorded = getRecorded();
+    return recorded > this->events.size() ? recorded - this->events.size() : 0;
+}
+
+double MPITrace::clockOffset(MPI_Comm comm) {
+    int* global;
+    int found;
+    MPI_Comm_get_attr(MPI_COMM_WORLD, MPI_WTIME_IS_GLOBAL, &global, &found);
+    if (found && *global) {
+        return 0;
+    }
+
+    int rank;
+    int size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    double offset = 0;
+    double best = DBL_MAX;
+    // Rank 0 answers each process in turn with its own clock; the process
+    // assumes the answer was read halfway through the round trip.
+    for (int peer = 1; peer < size; peer++) {
+        for (int i = 0; i < TRACE_SYNC_ROUNDS; i++) {
+            if (rank == 0) {
+                MPI_Recv(nullptr, 0, MPI_BYTE, peer, TRACE_TAG, comm, MPI_STATUS_IGNORE);
+                double now = MPI_Wtime();
+                MPI_Send(&now, 1, MPI_DOUBLE, peer, TRACE_TAG, comm);
+            } else if (rank == peer) {
+                double sent = MPI_Wtime();
+                double remote;
+                MPI_Send(nullptr, 0, MPI_BYTE, 0, TRACE_TAG, comm);
+                MPI_Recv(&remote, 1, MPI_DOUBLE, 0, TRACE_TAG, comm, MPI_STATUS_IGNORE);
+                double received = MPI_Wtime();
+                if (received - sent < best) {
+                    best = received - sent;
+                    offset = (sent + received) / 2 - remote;
+                }
+            }
+        }
+    }
+    return offset;
+}
+
+void MPITrace::write(MPI_Comm comm) {
+    int rank;
+    int size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    double offset = clockOffset(comm);
+
+    unsigned long last = getRecorded();
+    unsigned long first = getDropped();
+    size_t mask = this->events.size() - 1;
+    double earliest = DBL_MAX;
+    for (unsigned long i = first; i < last; i++) {
+        earliest = std::min(earliest, this->events[i & mask].start - offset);
+    }
+    double base;
+    MPI_Allreduce(&earliest, &base, 1, MPI_DOUBLE, MPI_MIN, comm);
+
+    std::ostringstream json;
+    json << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << rank
+        << ",\"args\":{\"name\":\"rank " << rank << "\"}},\n"
+        << "{\"name\":\"process_sort_index\",\"ph\":\"M\",\"pid\":" << rank
+        << ",\"args\":{\"sort_index\":" << rank << "}}";
+    json.precision(3);
+    json << std::fixed;
+    for (unsigned long i = first; i < last; i++) {
+        const MPITraceEvent& event = this->events[i & mask];
+        json << ",\n{\"name\":\"" << escape(event.name) << "\",\"cat\":\"mpi\",\"ph\":\"X\",\"pid\":" << rank
+            << ",\"tid\":" << event.thread
+            << ",\"ts\":" << (event.start - offset - base) * 1e6
+            << ",\"dur\":" << (event.end - event.start) * 1e6;
+        if (event.peer >= 0) {
+            json << ",\"args\":{\"peer\":" << event.peer << ",\"bytes\":" << event.bytes << "}";
+        }
+        json << "}";
+    }
+
+    std::string text = json.str();
+    int length = text.size();
+    std::vector<int> lengths(rank == 0 ? size : 0);
+    MPI_Gather(&length, 1, MPI_INT, lengths.data(), 1, MPI_INT, 0, comm);
+    std::vector<int> offsets(lengths.size(), 0);
+    for (size_t i = 1; i < lengths.size(); i++) {
+        offsets[i] = offsets[i - 1] + lengths[i - 1];
+    }
+    std::vector<char> merged(rank == 0 ? offsets.back() + lengths.back() : 0);
+    MPI_Gatherv(text.data(), length, MPI_CHAR, merged.data(), lengths.data(), offsets.data(), MPI_CHAR, 0, comm);
+
+    unsigned long dropped = getDropped();
+    unsigned long totalDropped;
+    MPI_Reduce(&dropped, &totalDropped, 1, MPI_UNSIGNED_LONG, MPI_SUM, 0, comm);
+    if (rank != 0) {
+        return;
+    }
+
+    std::ofstream out(this->path);
+    if (!out) {
+        std::cerr << "MPITrace: could not open " << this->path << std::endl;
+        return;
+    }
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    for (int i = 0; i < size; i++) {
+        if (i > 0) {
+            out << ",\n";
+        }
+        out.write(merged.data() + offsets[i], lengths[i]);
+    }
+    out << "\n]}\n";
+    if (totalDropped > 0) {
+        std::cerr << "MPITrace: " << totalDropped << " events were overwritten; "
+            << "only the most recent are in " << this->path << std::endl;
+    }
+}
@@ -0,0 +1,121 @@
+#ifndef MPI_TRACE_HPP
+#define MPI_TRACE_HPP
+#include <mpi.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+//
+// Event Tracing
+//
+// The wrapper can record a timestamped event for every send, receive, wait,
+// barrier, collective and work iteration into a fixed-size ring buffer per
+// process. When MPI is finalized, clocks are aligned to rank 0 and every
+// process's events are merged into one Chrome trace JSON file, which can be
+// opened in Perfetto (ui.perfetto.dev) or chrome://tracing.
+//
+// Tracing is off until enabled at run time, either with
+// MPIWrapper::setTracing(path) or by setting MPI_WRAPPER_TRACE=path in the
+// environment. Defining MPI_WRAPPER_NO_TRACE when compiling removes it
+// entirely.
+//
+
+#define TRACE_TAG 0x7A00
+#define TRACE_DEFAULT_CAPACITY (1 << 16)
+
+/**
+ * One timed span on one thread.
+ */
+struct MPITraceEvent {
+    // Points at a string literal, so recording never allocates.
+    const char* name;
+    double start;
+    double end;
+    int thread;
+    int peer;
+    long bytes;
+};
+
+/**
+ * A per-process ring buffer of trace events. Any thread may record without
+ * locking: each event claims the next slot with an atomic increment. Once
+ * the buffer is full the oldest events are overwritten.
+ */
+class MPITrace {
+private:
+    bool enabled = false;
+    std::string path;
+    size_t capacity;
+    std::vector<MPITraceEvent> events;
+    std::atomic<unsigned long> next;
+
+    /**
+     * @returns How far this process's clock is ahead of rank 0's, estimated
+     * from the fastest of several round trips.
+     */
+    static double clockOffset(MPI_Comm comm);
+
+public:
+    /**
+     * @param capacity The number of events to keep, rounded up to a power of
+     * two. Memory is only allocated once tracing is enabled.
+     */
+    MPITrace(size_t capacity=TRACE_DEFAULT_CAPACITY);
+
+    /**
+     * @returns If events are being recorded.
+     */
+    bool isEnabled() const {
+#ifdef MPI_WRAPPER_NO_TRACE
+        return false;
+#else
+        return enabled;
+#endif
+    }
+
+    /**
+     * Starts recording, to be written to the given file, or stops recording
+     * if the path is empty. Recorded events are kept when stopped.
+     *
+     * @param path The file to write the merged trace to on rank 0.
+     */
+    void setPath(std::string path);
+
+    /**
+     * @returns The file the merged trace will be written to.
+     */
+    const std::string& getPath() const;
+
+    /**
+     * Records a span that has already finished.
+     *
+     * @param name What the span was, as a string literal.
+     * @param start When the span began, from MPI_Wtime.
+     * @param end When the span ended, from MPI_Wtime.
+     * @param peer The rank communicated with, or -1 for none.
+     * @param bytes The number of bytes moved.
+     */
+    void record(const char* name, double start, double end, int peer=-1, long bytes=0);
+
+    /**
+     * @returns The number of events recorded, including any overwritten.
+     */
+    unsigned long getRecorded() const;
+
+    /**
+     * @returns The number of events lost to the buffer wrapping around.
+     */
+    unsigned long getDropped() const;
+
+    /**
+     * Aligns every process's clock to rank 0, merges their events and
+     * writes them from rank 0 as Chrome trace JSON. Each rank appears as its
+     * own process and each thread as its own track. Must be called on every
+     * process.
+     *
+     * @param comm The communicator the events were recorded on.
+     */
+    void write(MPI_Comm comm);
+};
+
+#endif // MPI_TRACE_HPP
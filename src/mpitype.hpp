@@ -1,6 +1,13 @@
 #ifndef MPI_TYPE_HPP
 #define MPI_TYPE_HPP
 #include "mpi.h"
+#include <array>
+#include <complex>
+#include <cstddef>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 template<typename T> struct mpi_type
 {
@@ -21,5 +28,120 @@ MAKE_MPI_TYPE(unsigned long long, MPI_UNSIGNED_LONG_LONG);
 MAKE_MPI_TYPE(float, MPI_FLOAT);
 MAKE_MPI_TYPE(double, MPI_DOUBLE);
 MAKE_MPI_TYPE(long double, MPI_LONG_DOUBLE);
+MAKE_MPI_TYPE(bool, MPI_CXX_BOOL);
+MAKE_MPI_TYPE(std::complex<float>, MPI_CXX_FLOAT_COMPLEX);
+MAKE_MPI_TYPE(std::complex<double>, MPI_CXX_DOUBLE_COMPLEX);
+MAKE_MPI_TYPE(std::complex<long double>, MPI_CXX_LONG_DOUBLE_COMPLEX);
 
-#endif // MPI_TYPE_HPP
\ No newline at end of file
+//
+// Derived Types
+//
+
+/**
+ * One field of a struct being described to MPI: where it sits in the struct,
+ * what type it holds, and how many of that type (for fixed-size arrays).
+ */
+struct mpi_field_info {
+    MPI_Aint offset;
+    MPI_Datatype type;
+    int count;
+};
+
+/**
+ * Describes a field of type M at the given byte offset. Fixed-size array
+ * members are described as a block of their element type.
+ *
+ * @param offset The byte offset of the field within its struct.
+ * @param M The type of the field.
+ *
+ * @return The field description.
+ */
+template<typename M>
+mpi_field_info mpi_field_of(size_t offset) {
+    typedef typename std::remove_all_extents<M>::type E;
+    mpi_field_info field;
+    field.offset = offset;
+    field.type = mpi_type<E>::get();
+    field.count = sizeof(M) / sizeof(E);
+    return field;
+}
+
+/**
+ * Builds and commits a struct datatype for T from a list of fields. The
+ * extent is resized to sizeof(T) so that arrays of T, padding included, are
+ * laid out correctly.
+ *
+ * @param fields The fields making up T.
+ * @param T The type being described.
+ *
+ * @return The committed datatype.
+ */
+template<typename T>
+MPI_Datatype mpi_struct_type(std::initializer_list<mpi_field_info> fields) {
+    std::vector<int> counts;
+    std::vector<MPI_Aint> offsets;
+    std::vector<MPI_Datatype> types;
+    for (const mpi_field_info& field : fields) {
+        counts.push_back(field.count);
+        offsets.push_back(field.offset);
+        types.push_back(field.type);
+    }
+    MPI_Datatype packed;
+    MPI_Datatype resized;
+    MPI_Type_create_struct(counts.size(), counts.data(), offsets.data(), types.data(), &packed);
+    MPI_Type_create_resized(packed, 0, sizeof(T), &resized);
+    MPI_Type_commit(&resized);
+    MPI_Type_free(&packed);
+    return resized;
+}
+
+/**
+ * Describes a member of a struct for MAKE_MPI_STRUCT_TYPE.
+ */
+#define MPI_FIELD(x, member) mpi_field_of<decltype(((x*)0)->member)>(offsetof(x, member))
+
+/**
+ * Registers a trivially-copyable struct with mpi_type. The datatype is built
+ * and committed the first time it is used, after MPI has been initialized,
+ * and is reused for the rest of the process.
+ *
+ * Usage: MAKE_MPI_STRUCT_TYPE(Particle, MPI_FIELD(Particle, x), MPI_FIELD(Particle, mass));
+ */
+#define MAKE_MPI_STRUCT_TYPE(x, ...) template<> struct mpi_type<x> { static const MPI_Datatype get() { \
+    static_assert(std::is_trivially_copyable<x>::value, "Only trivially-copyable types can be sent as structs"); \
+    static const MPI_Datatype type = mpi_struct_type<x>({ __VA_ARGS__ }); return type; } }
+
+template<typename A, typename B> struct mpi_type<std::pair<A, B>>
+{
+    static const MPI_Datatype get() {
+        static const MPI_Datatype type = build();
+        return type;
+    }
+
+private:
+    static MPI_Datatype build() {
+        std::pair<A, B> sample;
+        const char* base = reinterpret_cast<const char*>(&sample);
+        size_t first = reinterpret_cast<const char*>(&sample.first) - base;
+        size_t second = reinterpret_cast<const char*>(&sample.second) - base;
+        return mpi_struct_type<std::pair<A, B>>({ mpi_field_of<A>(first), mpi_field_of<B>(second) });
+    }
+};
+
+template<typename T, size_t N> struct mpi_type<std::array<T, N>>
+{
+    static const MPI_Datatype get() {
+        static const MPI_Datatype type = build();
+        return type;
+    }
+
+private:
+    static MPI_Datatype build() {
+        MPI_Datatype type;
+        MPI_Type_contiguous(N, mpi_type<T>::get(), &type);
+        MPI_Type_commit(&type);
+        return type;
+    }
+};
+
+#endif // MPI_TYPE_HPP
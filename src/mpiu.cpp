@@ -1,11 +1,27 @@
 #include "mpiu.hpp"
 #include "mpitype.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <iomanip>
 #include <sstream>
 //
 // Various Debug-Printing options. 
 //
 std::ostream hidden_stream(0);
 
+bool debug_blocking = true;
+int debug_threshold = DEBUG_SUMMARY_THRESHOLD;
+int debug_width = DEBUG_WIDTH;
+
+struct debug_pending {
+    MPI_Request request;
+    std::function<void ()> render;
+};
+
+std::deque<debug_pending> debug_queue;
+
 /**
  * Returns std::cout if the filter values are equal. Otherwise, returns an
  * empty ostream. Also returns std::cout if b is negative.
@@ -62,16 +78,201 @@ void debug_header(int rank, std::string header) {
  * @param marker A message to be printed before the data.
  */
 void debug_print(int rank, int size, std::string name, const int data, std::string marker) {
-    MPI_Barrier(MCW);
-    int* recv = new int[size];
-    MPI_Gather(&data, 1, MPI_INT, recv, 1, MPI_INT, 0, MCW);
-    if (rank == 0) {
+    std::shared_ptr<int> value = std::make_shared<int>(data);
+    std::shared_ptr<MPIBuffer<int>> recv = std::make_shared<MPIBuffer<int>>(MPIBufferPool::shared(), rank == 0 ? size : 0);
+    auto render = [rank, size, name, marker, recv, value]() {
+        if (rank != 0) {
+            return;
+        }
+        if (size > debug_threshold) {
+            debug_summary(marker + name, std::vector<double>(recv->begin(), recv->end()));
+            return;
+        }
         for (int i = 0; i < size; i++) {
-            filter_ios(i) << marker << i << " " << name << ": " << recv[i] << std::endl;
+            filter_ios(i) << marker << i << " " << name << ": " << (*recv)[i] << std::endl;
         }
+    };
+
+    if (!debug_blocking) {
+        MPI_Request request;
+        MPI_Igather(value.get(), 1, MPI_INT, recv->data(), 1, MPI_INT, 0, MCW, &request);
+        debug_defer(request, render);
+        return;
     }
-    delete[] recv;
+    debug_flush();
     MPI_Barrier(MCW);
+    MPI_Gather(value.get(), 1, MPI_INT, recv->data(), 1, MPI_INT, 0, MCW);
+    render();
+    MPI_Barrier(MCW);
+}
+
+/**
+ * Chooses how debug_print and debug_table collect values: with barriers
+ * around each call, or with a non-blocking gather printed later.
+ * 
+ * @param blocking Whether debug calls should wait for every process.
+ */
+void debug_set_blocking(bool blocking) {
+    debug_blocking = blocking;
+}
+
+/**
+ * @returns If debug calls wait for every process.
+ */
+bool debug_is_blocking() {
+    return debug_blocking;
+}
+
+/**
+ * Sets how many processes debug_print and debug_table show one by one
+ * before switching to a summary.
+ * 
+ * @param ranks The largest number of processes to show individually.
+ */
+void debug_set_summary_threshold(int ranks) {
+    debug_threshold = ranks;
+}
+
+/**
+ * Sets how wide debug_table output may be before it is split.
+ * 
+ * @param width The width in characters.
+ */
+void debug_set_width(int width) {
+    debug_width = width;
+}
+
+/**
+ * Queues output that waits on a non-blocking gather, and prints any queued
+ * output whose gather has completed, oldest first.
+ * 
+ * @param request The gather to wait for.
+ * @param render Prints the gathered values.
+ */
+void debug_defer(MPI_Request request, std::function<void ()> render) {
+    debug_queue.push_back(debug_pending{request, render});
+    while (!debug_queue.empty()) {
+        int done;
+        MPI_Test(&debug_queue.front().request, &done, MPI_STATUS_IGNORE);
+        if (!done) {
+            break;
+        }
+        debug_queue.front().render();
+        debug_queue.pop_front();
+    }
+}
+
+/**
+ * Waits for every queued non-blocking debug call and prints its output.
+ */
+void debug_flush() {
+    while (!debug_queue.empty()) {
+        MPI_Wait(&debug_queue.front().request, MPI_STATUS_IGNORE);
+        debug_queue.front().render();
+        debug_queue.pop_front();
+    }
+}
+
+/**
+ * Prints one value per process on rank 0, as tables wrapped to the debug
+ * width, or as a summary above the summary threshold.
+ * 
+ * @param name The name of the data being displayed.
+ * @param cells Each process's value, formatted.
+ * @param values Each process's value, for the summary.
+ */
+void debug_render_table(std::string name, const std::vector<std::string>& cells, const std::vector<double>& values) {
+    int size = cells.size();
+    if (size > debug_threshold) {
+        debug_summary(name, values);
+        return;
+    }
+    int col_size = std::to_string(size - 1).length();
+    for (const std::string& cell : cells) {
+        col_size = std::max(col_size, (int)cell.length());
+    }
+    col_size += 2;
+    int perTable = std::max(1, (debug_width - 1) / (col_size + 1));
+
+    for (int first = 0; first < size; first += perTable) {
+        int count = std::min(perTable, size - first);
+        std::string title = name;
+        if (size > perTable) {
+            title += " (" + std::to_string(first) + "-" + std::to_string(first + count - 1) + ")";
+        }
+        int width = col_size;
+        while ((1 + width) * count - 1 < (int)title.length()) {
+            width++;
+        }
+        int totalLen = (1 + width) * count - 1;
+        print_table_row("┌", "─", "┐", "─", [](int i) -> std::string { return ""; }, count, width);
+        std::cout << "│" << center_string(title, totalLen) << "│" << std::endl;
+        print_table_row("├", "┬", "┤", "─", [](int i) -> std::string { return ""; }, count, width);
+        print_table_row("│", "│", "│", " ", [first](int i) -> std::string { return std::to_string(first + i); }, count, width);
+        print_table_row("├", "┼", "┤", "─", [](int i) -> std::string { return ""; }, count, width);
+        print_table_row("│", "│", "│", " ", [&cells, first](int i) -> std::string { return cells[first + i]; }, count, width);
+        print_table_row("└", "┴", "┘", "─", [](int i) -> std::string { return ""; }, count, width);
+    }
+}
+
+/**
+ * Prints a summary of one value per process on rank 0: the range, mean and
+ * standard deviation, a histogram, and ranks more than three standard
+ * deviations from the mean.
+ * 
+ * @param name The name of the data being displayed.
+ * @param values Each process's value.
+ */
+void debug_summary(std::string name, const std::vector<double>& values) {
+    int size = values.size();
+    int lowRank = std::min_element(values.begin(), values.end()) - values.begin();
+    int highRank = std::max_element(values.begin(), values.end()) - values.begin();
+    double low = values[lowRank];
+    double high = values[highRank];
+    double mean = 0;
+    for (double value : values) {
+        mean += value;
+    }
+    mean /= size;
+    double variance = 0;
+    for (double value : values) {
+        variance += (value - mean) * (value - mean);
+    }
+    double stddev = std::sqrt(variance / size);
+
+    std::cout << name << ": " << size << " ranks, min " << low << " (rank " << lowRank << "), max " << high
+        << " (rank " << highRank << "), mean " << mean << ", stddev " << stddev << std::endl;
+
+    int bins = high > low ? DEBUG_BINS : 1;
+    double binWidth = (high - low) / bins;
+    std::vector<int> counts(bins, 0);
+    for (double value : values) {
+        counts[std::min(bins - 1, binWidth > 0 ? (int)((value - low) / binWidth) : 0)]++;
+    }
+    int most = *std::max_element(counts.begin(), counts.end());
+    for (int i = 0; i < bins; i++) {
+        std::ostringstream range;
+        range << "[" << low + i * binWidth << ", " << low + (i + 1) * binWidth << (i == bins - 1 ? "]" : ")");
+        std::cout << "  " << std::left << std::setw(24) << range.str() << std::right
+            << string_times("█", counts[i] * 40 / most) << " " << counts[i] << std::endl;
+    }
+
+    std::vector<int> outliers;
+    for (int i = 0; i < size && stddev > 0; i++) {
+        if (std::abs(values[i] - mean) > 3 * stddev) {
+            outliers.push_back(i);
+        }
+    }
+    if (!outliers.empty()) {
+        std::cout << "  outliers:";
+        for (size_t i = 0; i < outliers.size() && i < 10; i++) {
+            std::cout << " " << outliers[i] << "=" << values[outliers[i]];
+        }
+        if (outliers.size() > 10) {
+            std::cout << " and " << outliers.size() - 10 << " more";
+        }
+        std::cout << std::endl;
+    }
 }
 
 /**
@@ -148,4 +349,318 @@ void print_table_row(std::string leftCap, std::string mid, std::string rightCap,
         std::cout << (i != 0 ? mid : "") << center_string(data, col_size, fill_char);
     }
     std::cout << rightCap << std::endl;
-}
\ No newline at end of file
+}
+
+//
+// Local Reductions
+//
+// Each kernel is written once over GCC vector extensions, and instantiated
+// inside functions compiled for AVX2 (32-byte vectors) and AVX-512 (64-byte
+// vectors), so the same source builds without -mavx flags. Four independent
+// accumulators hide the latency of each vector operation.
+//
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86 1
+#define SIMD_INLINE inline __attribute__((always_inline))
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#define SIMD_TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define SIMD_X86 0
+#endif
+
+static MPISimdLevel simd_level = SIMD_SCALAR;
+static bool simd_level_set = false;
+
+MPISimdLevel simd_supported() {
+#if SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return SIMD_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return SIMD_AVX2;
+    }
+#endif
+    return SIMD_SCALAR;
+}
+
+MPISimdLevel simd_get_level() {
+    if (!simd_level_set) {
+        MPISimdLevel level = SIMD_AVX512;
+        const char* requested = std::getenv("MPI_WRAPPER_SIMD");
+        if (requested != nullptr && std::strcmp(requested, "scalar") == 0) {
+            level = SIMD_SCALAR;
+        } else if (requested != nullptr && std::strcmp(requested, "avx2") == 0) {
+            level = SIMD_AVX2;
+        }
+        simd_set_level(level);
+    }
+    return simd_level;
+}
+
+void simd_set_level(MPISimdLevel level) {
+    simd_level = std::min(level, simd_supported());
+    simd_level_set = true;
+}
+
+const char* simd_level_name(MPISimdLevel level) {
+    switch (level) {
+    case SIMD_AVX512:
+        return "avx512";
+    case SIMD_AVX2:
+        return "avx2";
+    default:
+        return "scalar";
+    }
+}
+
+#if SIMD_X86
+
+struct simd_add {
+    template<typename X>
+    SIMD_INLINE void operator()(X& acc, const X& value) const {
+        acc = acc + value;
+    }
+};
+
+struct simd_min {
+    template<typename X>
+    SIMD_INLINE void operator()(X& acc, const X& value) const {
+        acc = value < acc ? value : acc;
+    }
+};
+
+struct simd_max {
+    template<typename X>
+    SIMD_INLINE void operator()(X& acc, const X& value) const {
+        acc = acc < value ? value : acc;
+    }
+};
+
+/**
+ * Folds an array into one value with fn, starting from first.
+ *
+ * @param B The vector width in bytes.
+ */
+template<int B, typename T, typename F>
+SIMD_INLINE T simd_fold(const T* values, long count, T first, F fn) {
+    typedef T V __attribute__((vector_size(B)));
+    const long width = B / sizeof(T);
+    T result = first;
+    long i = 0;
+    if (count >= 4 * width) {
+        V acc[4];
+        std::memcpy(acc, values, sizeof(acc));
+        for (i = 4 * width; i + 4 * width <= count; i += 4 * width) {
+            V next[4];
+            std::memcpy(next, values + i, sizeof(next));
+            for (int k = 0; k < 4; k++) {
+                fn(acc[k], next[k]);
+            }
+        }
+        fn(acc[0], acc[1]);
+        fn(acc[2], acc[3]);
+        fn(acc[0], acc[2]);
+        for (long k = 0; k < width; k++) {
+            T lane = acc[0][k];
+            fn(result, lane);
+        }
+    }
+    for (; i < count; i++) {
+        fn(result, values[i]);
+    }
+    return result;
+}
+
+/**
+ * Finds the smallest and largest values in one pass.
+ *
+ * @param B The vector width in bytes.
+ */
+template<int B, typename T>
+SIMD_INLINE void simd_minmax(const T* values, long count, T& low, T& high) {
+    typedef T V __attribute__((vector_size(B)));
+    const long width = B / sizeof(T);
+    low = values[0];
+    high = values[0];
+    long i = 0;
+    if (count >= 2 * width) {
+        V lows[2];
+        V highs[2];
+        std::memcpy(lows, values, sizeof(lows));
+        std::memcpy(highs, values, sizeof(highs));
+        for (i = 2 * width; i + 2 * width <= count; i += 2 * width) {
+            V next[2];
+            std::memcpy(next, values + i, sizeof(next));
+            for (int k = 0; k < 2; k++) {
+                simd_min()(lows[k], next[k]);
+                simd_max()(highs[k], next[k]);
+            }
+        }
+        simd_min()(lows[0], lows[1]);
+        simd_max()(highs[0], highs[1]);
+        for (long k = 0; k < width; k++) {
+            T lane = lows[0][k];
+            simd_min()(low, lane);
+            lane = highs[0][k];
+            simd_max()(high, lane);
+        }
+    }
+    for (; i < count; i++) {
+        simd_min()(low, values[i]);
+        simd_max()(high, values[i]);
+    }
+}
+
+/**
+ * Adds up the products of two arrays.
+ *
+ * @param B The vector width in bytes.
+ */
+template<int B, typename T>
+SIMD_INLINE T simd_dot(const T* a, const T* b, long count) {
+    typedef T V __attribute__((vector_size(B)));
+    const long width = B / sizeof(T);
+    T result = T();
+    long i = 0;
+    if (count >= 4 * width) {
+        V acc[4] = {};
+        for (; i + 4 * width <= count; i += 4 * width) {
+            V left[4];
+            V right[4];
+            std::memcpy(left, a + i, sizeof(left));
+            std::memcpy(right, b + i, sizeof(right));
+            for (int k = 0; k < 4; k++) {
+                acc[k] += left[k] * right[k];
+            }
+        }
+        acc[0] += acc[1] + acc[2] + acc[3];
+        for (long k = 0; k < width; k++) {
+            result += acc[0][k];
+        }
+    }
+    for (; i < count; i++) {
+        result += a[i] * b[i];
+    }
+    return result;
+}
+
+/**
+ * Combines in into inout element by element with fn, as an MPI_Op does.
+ *
+ * @param B The vector width in bytes.
+ */
+template<int B, typename T, typename F>
+SIMD_INLINE void simd_into(const T* in, T* inout, long count, F fn) {
+    typedef T V __attribute__((vector_size(B)));
+    const long width = B / sizeof(T);
+    long i = 0;
+    for (; i + width <= count; i += width) {
+        V incoming;
+        V current;
+        std::memcpy(&incoming, in + i, B);
+        std::memcpy(&current, inout + i, B);
+        fn(current, incoming);
+        std::memcpy(inout + i, &current, B);
+    }
+    for (; i < count; i++) {
+        fn(inout[i], in[i]);
+    }
+}
+
+// One entry point per kernel and instruction set; the kernels above are
+// inlined into each and compiled for its target.
+
+template<typename T, typename F>
+SIMD_TARGET_AVX2 T simd_fold_avx2(const T* values, long count, T first, F fn) {
+    return simd_fold<32>(values, count, first, fn);
+}
+
+template<typename T, typename F>
+SIMD_TARGET_AVX512 T simd_fold_avx512(const T* values, long count, T first, F fn) {
+    return simd_fold<64>(values, count, first, fn);
+}
+
+template<typename T>
+SIMD_TARGET_AVX2 void simd_minmax_avx2(const T* values, long count, T& low, T& high) {
+    simd_minmax<32>(values, count, low, high);
+}
+
+template<typename T>
+SIMD_TARGET_AVX512 void simd_minmax_avx512(const T* values, long count, T& low, T& high) {
+    simd_minmax<64>(values, count, low, high);
+}
+
+template<typename T>
+SIMD_TARGET_AVX2 T simd_dot_avx2(const T* a, const T* b, long count) {
+    return simd_dot<32>(a, b, count);
+}
+
+template<typename T>
+SIMD_TARGET_AVX512 T simd_dot_avx512(const T* a, const T* b, long count) {
+    return simd_dot<64>(a, b, count);
+}
+
+template<typename T, typename F>
+SIMD_TARGET_AVX2 void simd_into_avx2(const T* in, T* inout, long count, F fn) {
+    simd_into<32>(in, inout, count, fn);
+}
+
+template<typename T, typename F>
+SIMD_TARGET_AVX512 void simd_into_avx512(const T* in, T* inout, long count, F fn) {
+    simd_into<64>(in, inout, count, fn);
+}
+
+#define SIMD_DISPATCH(kernel, ...) \
+    switch (simd_get_level()) { \
+    case SIMD_AVX512: \
+        return kernel##_avx512(__VA_ARGS__); \
+    case SIMD_AVX2: \
+        return kernel##_avx2(__VA_ARGS__); \
+    default: \
+        break; \
+    }
+
+#else
+#define SIMD_DISPATCH(kernel, ...)
+#endif // SIMD_X86
+
+#define DEFINE_MPI_SIMD(x) \
+x mpi_simd<x>::sum(const x* values, long count) { \
+    SIMD_DISPATCH(simd_fold, values, count, x(), simd_add()) \
+    return mpi_simd_scalar<x>::sum(values, count); \
+} \
+x mpi_simd<x>::min(const x* values, long count) { \
+    SIMD_DISPATCH(simd_fold, values, count, values[0], simd_min()) \
+    return mpi_simd_scalar<x>::min(values, count); \
+} \
+x mpi_simd<x>::max(const x* values, long count) { \
+    SIMD_DISPATCH(simd_fold, values, count, values[0], simd_max()) \
+    return mpi_simd_scalar<x>::max(values, count); \
+} \
+void mpi_simd<x>::minmax(const x* values, long count, x& low, x& high) { \
+    SIMD_DISPATCH(simd_minmax, values, count, low, high) \
+    mpi_simd_scalar<x>::minmax(values, count, low, high); \
+} \
+x mpi_simd<x>::dot(const x* a, const x* b, long count) { \
+    SIMD_DISPATCH(simd_dot, a, b, count) \
+    return mpi_simd_scalar<x>::dot(a, b, count); \
+} \
+void mpi_simd<x>::addInto(const x* in, x* inout, long count) { \
+    SIMD_DISPATCH(simd_into, in, inout, count, simd_add()) \
+    mpi_simd_scalar<x>::addInto(in, inout, count); \
+} \
+void mpi_simd<x>::minInto(const x* in, x* inout, long count) { \
+    SIMD_DISPATCH(simd_into, in, inout, count, simd_min()) \
+    mpi_simd_scalar<x>::minInto(in, inout, count); \
+} \
+void mpi_simd<x>::maxInto(const x* in, x* inout, long count) { \
+    SIMD_DISPATCH(simd_into, in, inout, count, simd_max()) \
+    mpi_simd_scalar<x>::maxInto(in, inout, count); \
+}
+
+DEFINE_MPI_SIMD(float)
+DEFINE_MPI_SIMD(double)
+DEFINE_MPI_SIMD(int)
+DEFINE_MPI_SIMD(long)
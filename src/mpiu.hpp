@@ -6,8 +6,15 @@
 #include <mpi.h>
 #include <stdlib.h>
 #include <math.h>
+#include <algorithm>
 #include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 #include "mpitype.hpp"
+#include "mpipool.hpp"
 
 //
 // MPI Debug Macros
@@ -29,6 +36,12 @@
 
 #define FILTER -1
 
+#define DEBUG_SUMMARY_THRESHOLD 32
+
+#define DEBUG_WIDTH 80
+
+#define DEBUG_BINS 10
+
 //
 // Useful Functions
 //
@@ -64,6 +77,77 @@ std::ostream& filter_ios(int filter);
  */
 void debug_header(int rank, std::string header);
 
+/**
+ * Chooses how debug_print and debug_table collect values. Blocking (the
+ * default) surrounds each call with barriers so its output lands between
+ * whatever each process printed before and after. Non-blocking starts an
+ * MPI_Igather and returns at once; rank 0 prints the results, in call order,
+ * as they complete during later debug calls or at debug_flush(). Must be set
+ * the same way on every process.
+ * 
+ * @param blocking Whether debug calls should wait for every process.
+ */
+void debug_set_blocking(bool blocking);
+
+/**
+ * @returns If debug calls wait for every process.
+ */
+bool debug_is_blocking();
+
+/**
+ * Sets how many processes debug_print and debug_table show one by one.
+ * Above this, they print a summary instead: the range, mean and standard
+ * deviation, a histogram, and the ranks whose values stand out.
+ * 
+ * @param ranks The largest number of processes to show individually.
+ * Defaults to 32.
+ */
+void debug_set_summary_threshold(int ranks);
+
+/**
+ * Sets how wide debug_table output may be. Tables wider than this are
+ * split into several tables covering consecutive ranks.
+ * 
+ * @param width The width in characters. Defaults to 80.
+ */
+void debug_set_width(int width);
+
+/**
+ * Queues output that waits on a non-blocking gather, and prints any queued
+ * output whose gather has completed.
+ * 
+ * @param request The gather to wait for.
+ * @param render Prints the gathered values. Holds the gather's buffers.
+ */
+void debug_defer(MPI_Request request, std::function<void ()> render);
+
+/**
+ * Waits for every queued non-blocking debug call and prints its output.
+ * Must be called on every process. The wrapper calls this before
+ * finalizing MPI.
+ */
+void debug_flush();
+
+/**
+ * Prints one value per process on rank 0, as tables wrapped to the debug
+ * width, or as a summary above the summary threshold.
+ * 
+ * @param name The name of the data being displayed.
+ * @param cells Each process's value, formatted.
+ * @param values Each process's value, for the summary.
+ */
+void debug_render_table(std::string name, const std::vector<std::string>& cells, const std::vector<double>& values);
+
+/**
+ * Prints a summary of one value per process on rank 0: the range, mean and
+ * standard deviation, a histogram, and ranks more than three standard
+ * deviations from the mean.
+ * 
+ * @param name The name of the data being displayed.
+ * @param values Each process's value.
+ */
+void debug_summary(std::string name, const std::vector<double>& values);
+
 /**
  * Prints a list of values from each process, collected into process 0 and then
  * printed in order.
@@ -79,21 +163,265 @@ void debug_header(int rank, std::string header);
  */
 void debug_print(int rank, int size, std::string name, const int data, std::string marker);
 
+//
+// Local Reductions
+//
+// Reduces arrays on this process with SIMD kernels: AVX-512 or AVX2 when the
+// CPU has them, picked at run time, and plain loops otherwise. float,
+// double, int and long have vector kernels; every other type uses the plain
+// loops. Vector kernels add floating-point values in a different order than
+// a loop would, so sums and dot products may differ in the last bits, and
+// min and max assume there are no NaNs.
+//
+
+/**
+ * The instruction sets the local reduction kernels can use.
+ */
+enum MPISimdLevel {
+    SIMD_SCALAR,
+    SIMD_AVX2,
+    SIMD_AVX512
+};
+
+/**
+ * @returns The best level this CPU supports.
+ */
+MPISimdLevel simd_supported();
+
+/**
+ * @returns The level the kernels run at: the best supported, unless lowered
+ * by simd_set_level or the MPI_WRAPPER_SIMD environment variable (scalar,
+ * avx2 or avx512).
+ */
+MPISimdLevel simd_get_level();
+
+/**
+ * Sets the level the kernels run at, such as to compare them. Levels the
+ * CPU does not support are lowered to the best it does.
+ *
+ * @param level The level to use.
+ */
+void simd_set_level(MPISimdLevel level);
+
+/**
+ * @returns The name of a level: "scalar", "avx2" or "avx512".
+ */
+const char* simd_level_name(MPISimdLevel level);
+
+/**
+ * The plain-loop kernels, used for types without vector kernels and as the
+ * fallback when the CPU has no vector support. min, max and minmax need
+ * count > 0.
+ *
+ * @param T The arithmetic type to reduce.
+ */
+template<typename T>
+struct mpi_simd_scalar {
+    static T sum(const T* values, long count) {
+        T result = T();
+        for (long i = 0; i < count; i++) {
+            result += values[i];
+        }
+        return result;
+    }
+
+    static T min(const T* values, long count) {
+        T result = values[0];
+        for (long i = 1; i < count; i++) {
+            result = values[i] < result ? values[i] : result;
+        }
+        return result;
+    }
+
+    static T max(const T* values, long count) {
+        T result = values[0];
+        for (long i = 1; i < count; i++) {
+            result = result < values[i] ? values[i] : result;
+        }
+        return result;
+    }
+
+    static void minmax(const T* values, long count, T& low, T& high) {
+        low = values[0];
+        high = values[0];
+        for (long i = 1; i < count; i++) {
+            low = values[i] < low ? values[i] : low;
+            high = high < values[i] ? values[i] : high;
+        }
+    }
+
+    static T dot(const T* a, const T* b, long count) {
+        T result = T();
+        for (long i = 0; i < count; i++) {
+            result += a[i] * b[i];
+        }
+        return result;
+    }
+
+    static void addInto(const T* in, T* inout, long count) {
+        for (long i = 0; i < count; i++) {
+            inout[i] = in[i] + inout[i];
+        }
+    }
+
+    static void minInto(const T* in, T* inout, long count) {
+        for (long i = 0; i < count; i++) {
+            inout[i] = in[i] < inout[i] ? in[i] : inout[i];
+        }
+    }
+
+    static void maxInto(const T* in, T* inout, long count) {
+        for (long i = 0; i < count; i++) {
+            inout[i] = inout[i] < in[i] ? in[i] : inout[i];
+        }
+    }
+};
+
+/**
+ * The kernels behind the local_* functions and mpi_simd_op, with the same
+ * members as mpi_simd_scalar. Types with vector kernels specialize it.
+ *
+ * @param T The arithmetic type to reduce.
+ */
+template<typename T>
+struct mpi_simd : public mpi_simd_scalar<T> {};
+
+/**
+ * Declares a specialization of mpi_simd with vector kernels, defined in
+ * mpiu.cpp.
+ */
+#define DECLARE_MPI_SIMD(x) template<> struct mpi_simd<x> { \
+    static x sum(const x* values, long count); \
+    static x min(const x* values, long count); \
+    static x max(const x* values, long count); \
+    static void minmax(const x* values, long count, x& low, x& high); \
+    static x dot(const x* a, const x* b, long count); \
+    static void addInto(const x* in, x* inout, long count); \
+    static void minInto(const x* in, x* inout, long count); \
+    static void maxInto(const x* in, x* inout, long count); }
+
+DECLARE_MPI_SIMD(float);
+DECLARE_MPI_SIMD(double);
+DECLARE_MPI_SIMD(int);
+DECLARE_MPI_SIMD(long);
+
+/**
+ * Adds up an array.
+ * 
+ * @param values The array.
+ * @param count The number of values.
+ * 
+ * @return The sum, or 0 when empty.
+ * 
+ * @order O(n), at memory bandwidth.
+ */
+template<typename T>
+T local_sum(const T* values, long count) {
+    return mpi_simd<T>::sum(values, count);
+}
+
+/**
+ * Finds the smallest value in an array.
+ * 
+ * @param values The array.
+ * @param count The number of values.
+ * 
+ * @return The smallest value, or the largest T when empty.
+ */
+template<typename T>
+T local_min(const T* values, long count) {
+    return count > 0 ? mpi_simd<T>::min(values, count) : std::numeric_limits<T>::max();
+}
+
+/**
+ * Finds the largest value in an array.
+ * 
+ * @param values The array.
+ * @param count The number of values.
+ * 
+ * @return The largest value, or the lowest T when empty.
+ */
+template<typename T>
+T local_max(const T* values, long count) {
+    return count > 0 ? mpi_simd<T>::max(values, count) : std::numeric_limits<T>::lowest();
+}
+
+/**
+ * Finds the smallest and largest values in an array in one pass.
+ * 
+ * @param values The array.
+ * @param count The number of values.
+ * 
+ * @return The smallest and largest values, or the largest and lowest T
+ * when empty.
+ */
+template<typename T>
+std::pair<T, T> local_minmax(const T* values, long count) {
+    std::pair<T, T> result(std::numeric_limits<T>::max(), std::numeric_limits<T>::lowest());
+    if (count > 0) {
+        mpi_simd<T>::minmax(values, count, result.first, result.second);
+    }
+    return result;
+}
+
+/**
+ * Finds where the smallest value in an array is: the vector kernel finds
+ * the value, and a search finds its first position.
+ * 
+ * @param values The array.
+ * @param count The number of values.
+ * 
+ * @return The index of the first smallest value, or -1 when empty.
+ */
+template<typename T>
+long local_argmin(const T* values, long count) {
+    if (count <= 0) {
+        return -1;
+    }
+    return std::find(values, values + count, mpi_simd<T>::min(values, count)) - values;
+}
+
+/**
+ * Finds where the largest value in an array is.
+ * 
+ * @param values The array.
+ * @param count The number of values.
+ * 
+ * @return The index of the first largest value, or -1 when empty.
+ */
+template<typename T>
+long local_argmax(const T* values, long count) {
+    if (count <= 0) {
+        return -1;
+    }
+    return std::find(values, values + count, mpi_simd<T>::max(values, count)) - values;
+}
+
+/**
+ * Multiplies two arrays element by element and adds up the products.
+ * 
+ * @param a The first array.
+ * @param b The second array.
+ * @param count The number of values in each.
+ * 
+ * @return The dot product, or 0 when empty.
+ */
+template<typename T>
+T local_dot(const T* a, const T* b, long count) {
+    return mpi_simd<T>::dot(a, b, count);
+}
+
 /**
  * Finds the max value in an array of arbitrary size.
  * 
  * @param arr The array to look through.
  * @param size The array size.
  * 
- * @return The max value in the array.
+ * @return The max value in the array, or the lowest T when empty.
  */
 template <typename T>
 T max_val_in(T* arr, int size) {
-    T maxVal;
-    for (int i = 0; i < size; i++) {
-        maxVal = std::max(maxVal, arr[i]);
-    }
-    return maxVal;
+    return local_max<T>(arr, size);
 }
 
 /**
@@ -103,15 +431,11 @@ T max_val_in(T* arr, int size) {
  * @param size The array size.
  * @param init The initial value.
  * 
- * @return The max value in the array.
+ * @return The max value in the array, or init if it is larger.
  */
 template <typename T>
 T max_val_in(T* arr, int size, T init) {
-    T maxVal = init;
-    for (int i = 0; i < size; i++) {
-        maxVal = std::max(maxVal, arr[i]);
-    }
-    return maxVal;
+    return std::max(init, local_max<T>(arr, size));
 }
 
 /**
@@ -176,25 +500,31 @@ std::string fill_char, std::function<std::string (int)> provider, int size, int
  */
 template <typename T>
 void debug_table(int rank, int size, std::string name, const T data) {
-    MPI_Barrier(MCW);
-    T* recv = new T[size];
-    MPI_Gather(&data, 1, mpi_type<T>::get(), recv, 1, mpi_type<T>::get(), 0, MCW);
-
-    int maxIdLen = std::log10(size-1);
-    int maxValLen = std::log10(max_val_in<T>(recv, size, 0));
-    int col_size = std::max(maxIdLen, maxValLen) + 3;
-    int totalLen = (1 + col_size) * size - 1;
-    if (rank == 0) {
-        print_table_row("┌", "─", "┐", "─", [](int i) -> std::string { return ""; }, size, col_size);
-        std::cout << "│" << center_string(name, totalLen) << "│" << std::endl;
-        print_table_row("├", "┬", "┤", "─", [](int i) -> std::string { return ""; }, size, col_size);
-        print_table_row("│", "│", "│", " ", [](int i) -> std::string { return std::to_string(i); }, size, col_size);
-        print_table_row("├", "┼", "┤", "─", [](int i) -> std::string { return ""; }, size, col_size);
-        print_table_row("│", "│", "│", " ", [recv](int i) -> std::string { return std::to_string(recv[i]); }, size, col_size);
-        print_table_row("└", "┴", "┘", "─", [](int i) -> std::string { return ""; }, size, col_size);
-    }
+    std::shared_ptr<T> value = std::make_shared<T>(data);
+    std::shared_ptr<MPIBuffer<T>> recv = std::make_shared<MPIBuffer<T>>(MPIBufferPool::shared(), rank == 0 ? size : 0);
+    auto render = [rank, name, recv, value]() {
+        if (rank != 0) {
+            return;
+        }
+        std::vector<std::string> cells;
+        std::vector<double> values;
+        for (const T& received : *recv) {
+            cells.push_back(std::to_string(received));
+            values.push_back(received);
+        }
+        debug_render_table(name, cells, values);
+    };
 
-    delete[] recv;
+    if (!debug_is_blocking()) {
+        MPI_Request request;
+        MPI_Igather(value.get(), 1, mpi_type<T>::get(), recv->data(), 1, mpi_type<T>::get(), 0, MCW, &request);
+        debug_defer(request, render);
+        return;
+    }
+    debug_flush();
+    MPI_Barrier(MCW);
+    MPI_Gather(value.get(), 1, mpi_type<T>::get(), recv->data(), 1, mpi_type<T>::get(), 0, MCW);
+    render();
     MPI_Barrier(MCW);
 }
 
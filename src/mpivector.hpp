@@ -0,0 +1,388 @@
+#ifndef MPI_VECTOR_HPP
+#define MPI_VECTOR_HPP
+#include <algorithm>
+#include <vector>
+#include "mpiop.hpp"
+#include "mpiwrapper.hpp"
+
+/**
+ * How a DistributedVector's elements are dealt out to processes.
+ *  - LAYOUT_BLOCK: each process holds one contiguous run, with lower ranks
+ *    taking the remainder, as in scatterMultiple and readBlocks.
+ *  - LAYOUT_CYCLIC: element i is on process i % p.
+ */
+enum MPILayout {
+    LAYOUT_BLOCK,
+    LAYOUT_CYCLIC
+};
+
+/**
+ * Moves values between processes so that each holds a standard block of
+ * the whole, lower ranks taking the remainder, keeping the order of the
+ * values when every process's values are laid end to end in rank order.
+ *
+ * @param mpi The wrapper to balance over.
+ * @param values This process's values, replaced by its block.
+ * @param T The MPI-supported type to move.
+ *
+ * @order O(n / p) values moved per process.
+ */
+template<typename T>
+void block_rebalance(MPIWrapper& mpi, std::vector<T>& values) {
+    int size = mpi.getSize();
+    long first = mpi.exscan<long>(values.size(), MPI_SUM, 0);
+    long length = mpi.allreduce<long>(values.size(), MPI_SUM);
+    long quotient = length / size;
+    long remainder = length % size;
+    std::vector<std::vector<T>> outgoing(size);
+    for (size_t i = 0; i < values.size(); i++) {
+        long index = first + i;
+        int owner = index < (quotient + 1) * remainder ? index / (quotient + 1)
+            : remainder + (index - (quotient + 1) * remainder) / quotient;
+        outgoing[owner].push_back(values[i]);
+    }
+    std::vector<std::vector<T>> incoming = mpi.alltoallMultiple<T>(outgoing);
+    values.clear();
+    for (const std::vector<T>& part : incoming) {
+        values.insert(values.end(), part.begin(), part.end());
+    }
+}
+
+/**
+ * A vector whose elements are spread across every process of a wrapper.
+ * Each process owns its share of the elements as a local std::vector, and
+ * the algorithms below work on the local shares and combine them with
+ * collectives. Every method that returns a whole-vector result is
+ * collective and must be called on every process.
+ *
+ * @param T The MPI-supported element type.
+ */
+template<typename T>
+class DistributedVector {
+private:
+    template<typename U>
+    friend class DistributedVector;
+
+    MPIWrapper& mpi;
+    long length;
+    MPILayout layout;
+    std::vector<T> values;
+
+    DistributedVector(MPIWrapper& mpi, long length, MPILayout layout, std::vector<T>&& values) :
+        mpi(mpi), length(length), layout(layout), values(std::move(values)) {}
+
+    /**
+     * @returns The index of the first element the given process holds in a
+     * block layout.
+     */
+    long blockFirst(int rank) const {
+        long size = mpi.getSize();
+        return rank * (length / size) + std::min<long>(rank, length % size);
+    }
+
+    /**
+     * @returns The number of elements the given process holds in a layout.
+     */
+    long countOn(MPILayout layout, int rank) const {
+        long size = mpi.getSize();
+        if (layout == LAYOUT_CYCLIC) {
+            return (length - rank + size - 1) / size;
+        }
+        return length / size + (rank < length % size ? 1 : 0);
+    }
+
+    /**
+     * @returns The process holding element index in a layout.
+     */
+    int ownerIn(MPILayout layout, long index) const {
+        long size = mpi.getSize();
+        if (layout == LAYOUT_CYCLIC) {
+            return index % size;
+        }
+        long quotient = length / size;
+        long remainder = length % size;
+        if (index < (quotient + 1) * remainder) {
+            return index / (quotient + 1);
+        }
+        return remainder + (index - (quotient + 1) * remainder) / quotient;
+    }
+
+public:
+    /**
+     * Creates a vector of the given length with every element set to a
+     * value. Must be called on every process.
+     *
+     * @param mpi The wrapper to spread the vector over.
+     * @param length The number of elements across all processes.
+     * @param value The value of every element. Defaults to T().
+     * @param layout How elements are dealt out. Defaults to blocks.
+     */
+    DistributedVector(MPIWrapper& mpi, long length, const T& value=T(), MPILayout layout=LAYOUT_BLOCK) :
+        mpi(mpi), length(length), layout(layout) {
+        this->values.assign(countOn(layout, mpi.getRank()), value);
+    }
+
+    /**
+     * Creates a block-laid-out vector from each process's block, which may
+     * differ in length. Must be called on every process.
+     *
+     * @param mpi The wrapper to spread the vector over.
+     * @param local This process's block.
+     *
+     * @return The vector. Its blocks are evened out with rebalance().
+     */
+    static DistributedVector<T> fromBlocks(MPIWrapper& mpi, const std::vector<T>& local) {
+        long length = mpi.allreduce<long>(local.size(), MPI_SUM);
+        DistributedVector<T> result(mpi, length, LAYOUT_BLOCK, std::vector<T>(local));
+        result.rebalance();
+        return result;
+    }
+
+    /**
+     * @returns The wrapper the vector is spread over.
+     */
+    MPIWrapper& getWrapper() const {
+        return this->mpi;
+    }
+
+    /**
+     * @returns The number of elements across all processes.
+     */
+    long size() const {
+        return this->length;
+    }
+
+    /**
+     * @returns How elements are dealt out.
+     */
+    MPILayout getLayout() const {
+        return this->layout;
+    }
+
+    /**
+     * @returns This process's elements, in increasing global index.
+     */
+    std::vector<T>& local() {
+        return this->values;
+    }
+
+    /**
+     * @returns This process's elements, in increasing global index.
+     */
+    const std::vector<T>& local() const {
+        return this->values;
+    }
+
+    /**
+     * @param index A global index.
+     *
+     * @returns The rank of the process holding the element.
+     *
+     * @order O(1).
+     */
+    int owner(long index) const {
+        return ownerIn(this->layout, index);
+    }
+
+    /**
+     * @param index A global index.
+     *
+     * @returns Where the element sits in its owner's local elements.
+     *
+     * @order O(1).
+     */
+    long offset(long index) const {
+        if (this->layout == LAYOUT_CYCLIC) {
+            return index / mpi.getSize();
+        }
+        return index - blockFirst(owner(index));
+    }
+
+    /**
+     * @param offset A position in this process's local elements.
+     *
+     * @returns The global index of the element.
+     *
+     * @order O(1).
+     */
+    long globalIndex(long offset) const {
+        if (this->layout == LAYOUT_CYCLIC) {
+            return offset * mpi.getSize() + mpi.getRank();
+        }
+        return blockFirst(mpi.getRank()) + offset;
+    }
+
+    /**
+     * Calls a function on every local element, with its global index.
+     * Not collective.
+     *
+     * @param fn Called as fn(T& value, long index).
+     */
+    template<typename F>
+    void for_each(F fn) {
+        for (size_t i = 0; i < this->values.size(); i++) {
+            fn(this->values[i], globalIndex(i));
+        }
+    }
+
+    /**
+     * Maps every element into a new vector with the same layout. Not
+     * collective.
+     *
+     * @param fn Called as U fn(const T& value).
+     * @param U The MPI-supported element type of the result.
+     *
+     * @return The mapped vector.
+     */
+    template<typename U, typename F>
+    DistributedVector<U> transform(F fn) const {
+        std::vector<U> mapped;
+        mapped.reserve(this->values.size());
+        for (const T& value : this->values) {
+            mapped.push_back(fn(value));
+        }
+        return DistributedVector<U>(this->mpi, this->length, this->layout, std::move(mapped));
+    }
+
+    /**
+     * Combines every element into one value, given to every process.
+     *
+     * @param identity The identity of fn, such as 0 for addition. Each
+     * process starts its share from it.
+     * @param fn The function to combine values with, as T(const T&, const T&).
+     * Must be associative and commutative.
+     *
+     * @return The combined value.
+     *
+     * @order O(n / p + log p).
+     */
+    template<typename F>
+    T reduce(const T& identity, const F& fn) const {
+        T partial = identity;
+        for (const T& value : this->values) {
+            partial = fn(partial, value);
+        }
+        return mpi.allreduce<T>(partial, fn);
+    }
+
+    /**
+     * Counts the elements a predicate holds for, on every process.
+     *
+     * @param predicate Called as bool predicate(const T& value).
+     *
+     * @return The number of matching elements.
+     *
+     * @order O(n / p + log p).
+     */
+    template<typename P>
+    long count_if(P predicate) const {
+        long count = std::count_if(this->values.begin(), this->values.end(), predicate);
+        return mpi.allreduce<long>(count, MPI_SUM);
+    }
+
+    /**
+     * Computes running totals in global index order: element i of the
+     * result combines elements 0 through i. Cyclic vectors are moved to
+     * blocks and back to do this.
+     *
+     * @param identity The identity of fn, such as 0 for addition.
+     * @param fn The function to combine values with, as T(const T&, const T&).
+     * Must be associative and commutative.
+     *
+     * @return The running totals, with the same layout.
+     *
+     * @order O(n / p + log p), plus two redistributions when cyclic.
+     */
+    template<typename F>
+    DistributedVector<T> inclusive_scan(const T& identity, const F& fn) const {
+        DistributedVector<T> result(*this);
+        MPILayout original = result.layout;
+        result.redistribute(LAYOUT_BLOCK);
+        T total = identity;
+        for (T& value : result.values) {
+            total = fn(total, value);
+            value = total;
+        }
+        T before = mpi.exscan<T>(total, mpi_lambda_op<T, F>::get(fn), identity);
+        for (T& value : result.values) {
+            value = fn(before, value);
+        }
+        result.redistribute(original);
+        return result;
+    }
+
+    /**
+     * Moves elements between processes so that they are laid out the given
+     * way. Each process sends one message to each other process.
+     *
+     * @param target The layout to move to.
+     *
+     * @order O(n / p) values sent and received per process.
+     */
+    void redistribute(MPILayout target) {
+        if (target == this->layout) {
+            return;
+        }
+        int size = mpi.getSize();
+        int rank = mpi.getRank();
+        std::vector<std::vector<T>> outgoing(size);
+        for (size_t i = 0; i < this->values.size(); i++) {
+            outgoing[ownerIn(target, globalIndex(i))].push_back(this->values[i]);
+        }
+        std::vector<std::vector<T>> incoming = mpi.alltoallMultiple<T>(outgoing);
+
+        // Each process sent its elements in increasing global index, so
+        // where they land follows from where that process's run begins.
+        std::vector<T> result(countOn(target, rank));
+        for (int source = 0; source < size; source++) {
+            const std::vector<T>& part = incoming[source];
+            if (part.empty()) {
+                continue;
+            }
+            if (target == LAYOUT_CYCLIC) {
+                long first = blockFirst(source);
+                long index = first + ((rank - first % size) % size + size) % size;
+                std::copy(part.begin(), part.end(), result.begin() + index / size);
+            } else {
+                long first = blockFirst(rank);
+                long index = first + ((source - first % size) % size + size) % size;
+                for (size_t i = 0; i < part.size(); i++) {
+                    result[index - first + i * size] = part[i];
+                }
+            }
+        }
+        this->values.swap(result);
+        this->layout = target;
+    }
+
+    /**
+     * Evens out a block layout whose blocks have drifted from the standard
+     * sizes, such as after fromBlocks or a sort, keeping the global order.
+     * See block_rebalance.
+     *
+     * @order O(n / p) values moved per process.
+     */
+    void rebalance() {
+        block_rebalance<T>(mpi, this->values);
+        this->length = mpi.allreduce<long>(this->values.size(), MPI_SUM);
+        this->layout = LAYOUT_BLOCK;
+    }
+
+    /**
+     * Collects every element into the root, in global index order.
+     *
+     * @param root The rank to collect on. Defaults to 0.
+     *
+     * @return The elements on the root. Empty elsewhere.
+     */
+    std::vector<T> gather(const int& root=0) const {
+        if (this->layout == LAYOUT_BLOCK) {
+            return mpi.gatherMultiple<T>(this->values, root);
+        }
+        DistributedVector<T> blocks(*this);
+        blocks.redistribute(LAYOUT_BLOCK);
+        return mpi.gatherMultiple<T>(blocks.values, root);
+    }
+};
+
+#endif // MPI_VECTOR_HPP
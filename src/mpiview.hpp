@@ -0,0 +1,65 @@
+#ifndef MPI_VIEW_HPP
+#define MPI_VIEW_HPP
+#include <array>
+#include <cstddef>
+#include <vector>
+
+/**
+ * A non-owning view over contiguous storage, similar to std::span. Lets the
+ * wrapper send from and receive into part of a larger buffer without copying
+ * it into a container first.
+ *
+ * @param T The element type. Use a const type for read-only views.
+ */
+template<typename T>
+class MPIView {
+private:
+    T* ptr;
+    size_t length;
+
+public:
+    MPIView() : ptr(nullptr), length(0) {}
+    MPIView(T* ptr, size_t length) : ptr(ptr), length(length) {}
+
+    template<typename U>
+    MPIView(std::vector<U>& values) : ptr(values.data()), length(values.size()) {}
+
+    template<typename U>
+    MPIView(const std::vector<U>& values) : ptr(values.data()), length(values.size()) {}
+
+    template<typename U, size_t N>
+    MPIView(std::array<U, N>& values) : ptr(values.data()), length(N) {}
+
+    template<typename U, size_t N>
+    MPIView(const std::array<U, N>& values) : ptr(values.data()), length(N) {}
+
+    /**
+     * @returns A pointer to the first element.
+     */
+    T* data() const {
+        return this->ptr;
+    }
+
+    /**
+     * @returns The number of elements in the view.
+     */
+    size_t size() const {
+        return this->length;
+    }
+
+    /**
+     * @param offset The index of the first element of the subview.
+     * @param count The number of elements in the subview.
+     *
+     * @returns A view over count elements starting at offset.
+     */
+    MPIView<T> subview(size_t offset, size_t count) const {
+        return MPIView<T>(this->ptr + offset, count);
+    }
+
+    T& operator[](size_t i) const {
+        return this->ptr[i];
+    }
+};
+
+#endif // MPI_VIEW_HPP
@@ -0,0 +1,378 @@
+#ifndef MPI_WINDOW_HPP
+#define MPI_WINDOW_HPP
+#include <mpi.h>
+#include <vector>
+#include "mpitype.hpp"
+
+/**
+ * An array of values on every process that other processes can read and
+ * update one-sidedly, made by MPIWrapper::createWindow. The target of a
+ * put, get, accumulate or fetchAndOp takes no part in it: no receive is
+ * posted and nothing needs polling.
+ *
+ * One-sided operations must happen inside an access epoch, and are only
+ * complete, with their results readable, once the epoch ends or is flushed:
+ *  - Active target: every process calls fence() (or holds an MPIFenceEpoch),
+ *    and operations between two fences complete at the second.
+ *  - Passive target: the origin alone locks a target (lock/lockAll, or an
+ *    MPILockEpoch), and operations complete at flush() or unlock().
+ * Local reads and writes of data() should also be separated from remote
+ * access by a fence, or by a lock on this process's own rank.
+ *
+ * Movable but not copyable; freeing the window is collective, and happens on
+ * destruction.
+ *
+ * @param T The MPI-supported type of the values.
+ */
+template<typename T>
+class MPIWindow {
+private:
+    MPI_Win window;
+    T* base;
+    long count;
+
+public:
+    MPIWindow() : window(MPI_WIN_NULL), base(nullptr), count(0) {}
+
+    /**
+     * Allocates this process's part of the window. Must be called on every
+     * process of the communicator.
+     *
+     * @param comm The processes that may access each other's values.
+     * @param count The number of values on this process. May differ between
+     * processes.
+     */
+    MPIWindow(MPI_Comm comm, long count) : base(nullptr), count(count) {
+        MPI_Win_allocate(count * sizeof(T), sizeof(T), MPI_INFO_NULL, comm, &this->base, &this->window);
+    }
+
+    MPIWindow(MPIWindow&& other) : window(other.window), base(other.base), count(other.count) {
+        other.window = MPI_WIN_NULL;
+        other.base = nullptr;
+        other.count = 0;
+    }
+
+    MPIWindow& operator=(MPIWindow&& other) {
+        if (this != &other) {
+            free();
+            this->window = other.window;
+            this->base = other.base;
+            this->count = other.count;
+            other.window = MPI_WIN_NULL;
+            other.base = nullptr;
+            other.count = 0;
+        }
+        return *this;
+    }
+
+    MPIWindow(const MPIWindow& other) = delete;
+    MPIWindow& operator=(const MPIWindow& other) = delete;
+
+    ~MPIWindow() {
+        free();
+    }
+
+    /**
+     * Releases the window. Must be called on every process, outside of any
+     * epoch; afterwards the window is empty.
+     */
+    void free() {
+        int finalized;
+        MPI_Finalized(&finalized);
+        if (this->window != MPI_WIN_NULL && !finalized) {
+            MPI_Win_free(&this->window);
+        }
+        this->window = MPI_WIN_NULL;
+        this->base = nullptr;
+        this->count = 0;
+    }
+
+    /**
+     * @returns This process's values.
+     */
+    T* data() {
+        return this->base;
+    }
+
+    /**
+     * @returns The number of values on this process.
+     */
+    long size() const {
+        return this->count;
+    }
+
+    T* begin() {
+        return this->base;
+    }
+
+    T* end() {
+        return this->base + this->count;
+    }
+
+    T& operator[](long index) {
+        return this->base[index];
+    }
+
+    /**
+     * @returns The window, for MPI calls not wrapped here.
+     */
+    MPI_Win getWindow() const {
+        return this->window;
+    }
+
+    //
+    // Operations
+    //
+
+    /**
+     * Writes values into a target's part of the window.
+     *
+     * @param values The values to write. Must not change until the
+     * operation completes.
+     * @param count The number of values.
+     * @param target The rank to write to.
+     * @param index Where in the target's values to start.
+     */
+    void put(const T* values, const int& count, const int& target, const long& index) {
+        MPI_Put(values, count, mpi_type<T>::get(), target, index, count, mpi_type<T>::get(), this->window);
+    }
+
+    /**
+     * Writes one value into a target's part of the window.
+     *
+     * @param value The value to write. Must not change until the operation
+     * completes.
+     * @param target The rank to write to.
+     * @param index Where in the target's values to write.
+     */
+    void put(const T& value, const int& target, const long& index) {
+        put(&value, 1, target, index);
+    }
+
+    /**
+     * Reads values from a target's part of the window.
+     *
+     * @param values Filled with the values once the operation completes.
+     * @param count The number of values.
+     * @param target The rank to read from.
+     * @param index Where in the target's values to start.
+     */
+    void get(T* values, const int& count, const int& target, const long& index) {
+        MPI_Get(values, count, mpi_type<T>::get(), target, index, count, mpi_type<T>::get(), this->window);
+    }
+
+    /**
+     * Reads one value from a target's part of the window.
+     *
+     * @param value Set to the value once the operation completes.
+     * @param target The rank to read from.
+     * @param index Where in the target's values to read.
+     */
+    void get(T& value, const int& target, const long& index) {
+        get(&value, 1, target, index);
+    }
+
+    /**
+     * Combines values into a target's part of the window. Accumulates to
+     * the same place from different processes are applied one at a time, so
+     * concurrent updates are never lost.
+     *
+     * @param values The values to combine in. Must not change until the
+     * operation completes.
+     * @param count The number of values.
+     * @param target The rank to update.
+     * @param index Where in the target's values to start.
+     * @param op A predefined operation, such as MPI_SUM, or MPI_REPLACE.
+     * Defaults to MPI_SUM.
+     */
+    void accumulate(const T* values, const int& count, const int& target, const long& index, MPI_Op op=MPI_SUM) {
+        MPI_Accumulate(values, count, mpi_type<T>::get(), target, index, count, mpi_type<T>::get(), op, this->window);
+    }
+
+    /**
+     * Combines one value into a target's part of the window.
+     *
+     * @param value The value to combine in. Must not change until the
+     * operation completes.
+     * @param target The rank to update.
+     * @param index Where in the target's values to update.
+     * @param op A predefined operation, such as MPI_SUM. Defaults to MPI_SUM.
+     */
+    void accumulate(const T& value, const int& target, const long& index, MPI_Op op=MPI_SUM) {
+        accumulate(&value, 1, target, index, op);
+    }
+
+    /**
+     * Combines one value into a target's part of the window and reads back
+     * what was there before, as one atomic step, such as to take tickets
+     * from a shared counter.
+     *
+     * @param value The value to combine in.
+     * @param previous Set to the value before the update once the operation
+     * completes.
+     * @param target The rank to update.
+     * @param index Where in the target's values to update.
+     * @param op A predefined operation, such as MPI_SUM, or MPI_NO_OP to
+     * only read. Defaults to MPI_SUM.
+     */
+    void fetchAndOp(const T& value, T& previous, const int& target, const long& index, MPI_Op op=MPI_SUM) {
+        MPI_Fetch_and_op(&value, &previous, mpi_type<T>::get(), target, index, op, this->window);
+    }
+
+    //
+    // Synchronization
+    //
+
+    /**
+     * Ends the current active-target epoch, completing its operations, and
+     * starts the next. Must be called on every process.
+     *
+     * @param assertion MPI_MODE_* hints about the epochs. Defaults to none.
+     */
+    void fence(int assertion=0) {
+        MPI_Win_fence(assertion, this->window);
+    }
+
+    /**
+     * Starts a passive-target epoch on one target.
+     *
+     * @param target The rank to access.
+     * @param exclusive Whether to keep every other process out until
+     * unlock. Defaults to a shared lock.
+     */
+    void lock(const int& target, bool exclusive=false) {
+        MPI_Win_lock(exclusive ? MPI_LOCK_EXCLUSIVE : MPI_LOCK_SHARED, target, 0, this->window);
+    }
+
+    /**
+     * Ends a passive-target epoch on one target, completing its operations.
+     *
+     * @param target The rank that was locked.
+     */
+    void unlock(const int& target) {
+        MPI_Win_unlock(target, this->window);
+    }
+
+    /**
+     * Starts a shared passive-target epoch on every process.
+     */
+    void lockAll() {
+        MPI_Win_lock_all(0, this->window);
+    }
+
+    /**
+     * Ends the passive-target epoch on every process, completing its
+     * operations.
+     */
+    void unlockAll() {
+        MPI_Win_unlock_all(this->window);
+    }
+
+    /**
+     * Completes every operation to a target so far, without ending the
+     * passive-target epoch.
+     *
+     * @param target The rank whose operations to complete.
+     */
+    void flush(const int& target) {
+        MPI_Win_flush(target, this->window);
+    }
+
+    /**
+     * Completes every operation so far, without ending the passive-target
+     * epoch.
+     */
+    void flushAll() {
+        MPI_Win_flush_all(this->window);
+    }
+
+    /**
+     * Syncs this process's public and private copies of its values, so that
+     * local reads see remote updates made in a passive-target epoch.
+     */
+    void sync() {
+        MPI_Win_sync(this->window);
+    }
+};
+
+/**
+ * An active-target epoch on a window for as long as the guard lives: fences
+ * when made and fences again when destroyed, so every operation issued in
+ * between is complete once it goes out of scope. Must be made on every
+ * process.
+ *
+ *     {
+ *         MPIFenceEpoch<long> epoch(window);
+ *         window.accumulate(1L, owner, index);
+ *     }
+ *
+ * @param T The value type of the window.
+ */
+template<typename T>
+class MPIFenceEpoch {
+private:
+    MPIWindow<T>& window;
+
+public:
+    MPIFenceEpoch(MPIWindow<T>& window) : window(window) {
+        window.fence();
+    }
+
+    MPIFenceEpoch(const MPIFenceEpoch& other) = delete;
+    MPIFenceEpoch& operator=(const MPIFenceEpoch& other) = delete;
+
+    ~MPIFenceEpoch() {
+        this->window.fence();
+    }
+};
+
+/**
+ * A passive-target epoch on a window for as long as the guard lives: locks
+ * one target, or every process, when made and unlocks when destroyed, so
+ * every operation issued in between is complete once it goes out of scope.
+ * Only the origin takes part.
+ *
+ * @param T The value type of the window.
+ */
+template<typename T>
+class MPILockEpoch {
+private:
+    MPIWindow<T>& window;
+    int target;
+
+public:
+    /**
+     * Locks one target.
+     *
+     * @param window The window to access.
+     * @param target The rank to access.
+     * @param exclusive Whether to keep every other process out. Defaults to
+     * a shared lock.
+     */
+    MPILockEpoch(MPIWindow<T>& window, const int& target, bool exclusive=false) :
+        window(window), target(target) {
+        window.lock(target, exclusive);
+    }
+
+    /**
+     * Locks every process, shared.
+     *
+     * @param window The window to access.
+     */
+    MPILockEpoch(MPIWindow<T>& window) : window(window), target(MPI_PROC_NULL) {
+        window.lockAll();
+    }
+
+    MPILockEpoch(const MPILockEpoch& other) = delete;
+    MPILockEpoch& operator=(const MPILockEpoch& other) = delete;
+
+    ~MPILockEpoch() {
+        if (this->target == MPI_PROC_NULL) {
+            this->window.unlockAll();
+        } else {
+            this->window.unlock(this->target);
+        }
+    }
+};
+
+#endif // MPI_WINDOW_HPP
@@ -2,15 +2,67 @@
 #include "mpiu.hpp"
 #include "mpitype.hpp"
 #include <cmath>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
 
 MPIWrapper::MPIWrapper(const MPIWrapper& other) : 
-    rank(other.rank), size(other.size), lastStatus(other.lastStatus),
-    world(other.world) {
+    world(other.world), grid(other.grid), size(other.size), rank(other.rank),
+    threadLevel(other.threadLevel), outstanding(other.outstanding),
+    outstandingLock(other.outstandingLock), profile(other.profile), trace(other.trace), progress(other.progress),
+    owned(other.owned), node(other.node), leaders(other.leaders), worldRanks(other.worldRanks) {
     this->scopes++;
 }
 
+MPIWrapper::MPIWrapper(const MPIWrapper& parent, MPI_Comm comm) :
+    world(comm), threadLevel(parent.threadLevel), outstanding(parent.outstanding),
+    outstandingLock(parent.outstandingLock), profile(parent.profile), trace(parent.trace), progress(parent.progress) {
+    // Children are never the wrapper that finalizes MPI.
+    this->scopes++;
+    this->owned = std::shared_ptr<MPI_Comm>(new MPI_Comm(comm), [](MPI_Comm* owned) {
+        int finalized;
+        MPI_Finalized(&finalized);
+        if (!finalized) {
+            MPI_Comm_free(owned);
+        }
+        delete owned;
+    });
+    int rank_temp;
+    int size_temp;
+    MPI_Comm_rank(comm, &rank_temp);
+    MPI_Comm_size(comm, &size_temp);
+    this->rank = rank_temp;
+    this->size = size_temp;
+
+    MPI_Group group;
+    MPI_Group worldGroup;
+    MPI_Comm_group(comm, &group);
+    MPI_Comm_group(MPI_COMM_WORLD, &worldGroup);
+    std::vector<int> ranks(this->size);
+    for (int i = 0; i < this->size; i++) {
+        ranks[i] = i;
+    }
+    this->worldRanks = std::make_shared<std::vector<int>>(this->size);
+    MPI_Group_translate_ranks(group, this->size, ranks.data(), worldGroup, this->worldRanks->data());
+    MPI_Group_free(&group);
+    MPI_Group_free(&worldGroup);
+}
+
 MPIWrapper::MPIWrapper(int argc, char** argv) {
-    MPI_Init(&argc, &argv);
+    init(argc, argv, MPI_THREAD_SINGLE);
+}
+
+MPIWrapper::MPIWrapper(int argc, char** argv, int threadLevel) {
+    init(argc, argv, threadLevel);
+}
+
+void MPIWrapper::init(int argc, char** argv, int requested) {
+    if (requested == MPI_THREAD_SINGLE) {
+        MPI_Init(&argc, &argv);
+    } else {
+        MPI_Init_thread(&argc, &argv, requested, &this->threadLevel);
+    }
     this->world = MPI_COMM_WORLD;
     int rank_temp;
     int size_temp;
@@ -18,16 +70,177 @@ MPIWrapper::MPIWrapper(int argc, char** argv) {
     MPI_Comm_size(world, &size_temp);
     this->rank = rank_temp;
     this->size = size_temp;
-    this->lastStatus = new MPI_Status();
+    if (this->threadLevel < requested && this->rank == 0) {
+        std::cerr << "MPIWrapper: requested thread level " << requested
+            << " but MPI only provides " << this->threadLevel << std::endl;
+    }
+    this->outstanding = std::make_shared<std::vector<std::shared_ptr<MPIRequestState>>>();
+    this->outstandingLock = std::make_shared<std::mutex>();
+    this->profile = std::make_shared<MPIProfile>(this->size);
+    const char* profiling = std::getenv("MPI_WRAPPER_PROFILE");
+    this->profile->setEnabled(profiling != nullptr && std::strcmp(profiling, "0") != 0);
+    this->trace = std::make_shared<MPITrace>();
+    this->progress = std::make_shared<MPIProgress>(this->threadLevel);
+    const char* tracing = std::getenv("MPI_WRAPPER_TRACE");
+    this->trace->setPath(tracing != nullptr ? tracing : "");
 }
 
 MPIWrapper::~MPIWrapper() {
     if (--(this->scopes) == 0) {
+        // The progress thread must not be testing requests while they are
+        // drained.
+        this->progress->stop();
+        drain();
+        if (this->profile->isEnabled()) {
+            reportProfile();
+        }
+        if (this->trace->isEnabled()) {
+            writeTrace();
+        }
+        if (this->grid != MPI_COMM_NULL) {
+            MPI_Comm_free(&this->grid);
+        }
+        debug_flush();
+        this->node.reset();
+        this->leaders.reset();
+        MPIBufferPool::shared().trim();
         MPI_Finalize();
-        delete this->lastStatus;
     }
 }
 
+MPI_Status*& MPIWrapper::currentStatus() {
+    static thread_local MPI_Status status;
+    static thread_local MPI_Status* current = &status;
+    return current;
+}
+
+MPI_Comm MPIWrapper::getComm() {
+    return this->world;
+}
+
+MPIWrapper MPIWrapper::split(int color, int key) {
+    MPI_Comm comm;
+    MPI_Comm_split(this->world, color, key, &comm);
+    return MPIWrapper(*this, comm);
+}
+
+MPIWrapper& MPIWrapper::getNode() {
+    if (!this->node) {
+        MPI_Comm comm;
+        MPI_Comm_split_type(this->world, MPI_COMM_TYPE_SHARED, getRank(), MPI_INFO_NULL, &comm);
+        this->node = std::make_shared<MPIWrapper>(MPIWrapper(*this, comm));
+    }
+    return *(this->node);
+}
+
+MPIWrapper& MPIWrapper::getLeaders() {
+    if (!this->leaders) {
+        this->leaders = std::make_shared<MPIWrapper>(split(isNodeLeader() ? 0 : 1, getRank()));
+    }
+    return *(this->leaders);
+}
+
+bool MPIWrapper::isNodeLeader() {
+    return getNode().getRank() == 0;
+}
+
+void MPIWrapper::setProfiling(bool enabled) {
+    this->profile->setEnabled(enabled);
+}
+
+MPIProfile& MPIWrapper::getProfile() {
+    return *(this->profile);
+}
+
+void MPIWrapper::reportProfile() {
+    this->profile->report(MPI_COMM_WORLD);
+}
+
+void MPIWrapper::setTracing(std::string path) {
+    this->trace->setPath(path);
+}
+
+MPITrace& MPIWrapper::getTrace() {
+    return *(this->trace);
+}
+
+void MPIWrapper::writeTrace() {
+    this->trace->write(this->world);
+}
+
+MPIProgress& MPIWrapper::getProgress() {
+    return *(this->progress);
+}
+
+MPIBufferPool& MPIWrapper::getBufferPool() {
+    return MPIBufferPool::shared();
+}
+
+void MPIWrapper::traceEvent(const char* name, double start) {
+    if (this->trace->isEnabled()) {
+        this->trace->record(name, start, MPI_Wtime());
+    }
+}
+
+void MPIWrapper::profileSend(int peer, long bytes, double start) {
+    if (this->profile->isEnabled()) {
+        this->profile->recordTime(PROFILE_SEND, start);
+        this->profile->recordSend(worldRank(peer), bytes);
+    }
+    if (this->trace->isEnabled()) {
+        this->trace->record("send", start, MPI_Wtime(), worldRank(peer), bytes);
+    }
+}
+
+void MPIWrapper::profileReceive(MPI_Status* status, double start) {
+    if (this->profile->isEnabled()) {
+        this->profile->recordTime(PROFILE_RECEIVE, start);
+        profileArrival(status);
+    }
+    if (this->trace->isEnabled()) {
+        int bytes;
+        MPI_Get_count(status, MPI_BYTE, &bytes);
+        this->trace->record("receive", start, MPI_Wtime(), worldRank(status->MPI_SOURCE), bytes);
+    }
+}
+
+void MPIWrapper::profileArrival(MPI_Status* status) {
+    this->profile->recordArrival(worldRank(status->MPI_SOURCE), *status);
+}
+
+int MPIWrapper::worldRank(int peer) {
+    if (!this->worldRanks || peer < 0 || peer >= this->size) {
+        return peer;
+    }
+    return (*this->worldRanks)[peer];
+}
+
+std::function<void (const MPI_Status&)> MPIWrapper::arrivalHook() {
+    std::shared_ptr<MPIProfile> profile = this->profile;
+    std::shared_ptr<std::vector<int>> worldRanks = this->worldRanks;
+    return [profile, worldRanks](const MPI_Status& status) {
+        int peer = status.MPI_SOURCE;
+        if (worldRanks && peer >= 0 && peer < (int)worldRanks->size()) {
+            peer = (*worldRanks)[peer];
+        }
+        profile->recordArrival(peer, status);
+    };
+}
+
+void MPIWrapper::profileTime(MPIProfileCategory category, double start) {
+    static const char* names[PROFILE_CATEGORIES] = {"send", "receive", "wait", "barrier", "collective"};
+    if (this->profile->isEnabled()) {
+        this->profile->recordTime(category, start);
+    }
+    if (this->trace->isEnabled()) {
+        this->trace->record(names[category], start, MPI_Wtime());
+    }
+}
+
+int MPIWrapper::getThreadLevel() {
+    return this->threadLevel;
+}
+
 int MPIWrapper::getRank() {
     return this->rank;
 }
@@ -36,6 +249,64 @@ int MPIWrapper::getCubeRank(const int dimension) {
     return (getRank() ^ (1 << dimension));
 }
 
+void MPIWrapper::createGrid(std::vector<int> dims, std::vector<bool> periodic, bool reorder) {
+    std::vector<int> wrap(dims.size(), 0);
+    for (size_t i = 0; i < periodic.size() && i < dims.size(); i++) {
+        wrap[i] = periodic[i];
+    }
+    MPI_Dims_create(getSize(), dims.size(), dims.data());
+    if (this->grid != MPI_COMM_NULL) {
+        MPI_Comm_free(&this->grid);
+    }
+    MPI_Cart_create(this->world, dims.size(), dims.data(), wrap.data(), reorder, &this->grid);
+}
+
+MPI_Comm MPIWrapper::getGrid() {
+    return this->grid;
+}
+
+std::vector<int> MPIWrapper::getGridShape() {
+    int dimensions;
+    MPI_Cartdim_get(this->grid, &dimensions);
+    std::vector<int> dims(dimensions);
+    std::vector<int> wrap(dimensions);
+    std::vector<int> coords(dimensions);
+    MPI_Cart_get(this->grid, dimensions, dims.data(), wrap.data(), coords.data());
+    return dims;
+}
+
+std::vector<int> MPIWrapper::getGridCoords() {
+    int dimensions;
+    MPI_Cartdim_get(this->grid, &dimensions);
+    std::vector<int> coords(dimensions);
+    MPI_Cart_coords(this->grid, getGridRank(), dimensions, coords.data());
+    return coords;
+}
+
+int MPIWrapper::getGridRank() {
+    int gridRank;
+    MPI_Comm_rank(this->grid, &gridRank);
+    return gridRank;
+}
+
+int MPIWrapper::getGridNeighbor(const int dimension, const int offset) {
+    int source;
+    int destination;
+    MPI_Cart_shift(this->grid, dimension, offset, &source, &destination);
+    if (destination == MPI_PROC_NULL) {
+        return MPI_PROC_NULL;
+    }
+    MPI_Group gridGroup;
+    MPI_Group worldGroup;
+    int worldRank;
+    MPI_Comm_group(this->grid, &gridGroup);
+    MPI_Comm_group(this->world, &worldGroup);
+    MPI_Group_translate_ranks(gridGroup, 1, &destination, worldGroup, &worldRank);
+    MPI_Group_free(&gridGroup);
+    MPI_Group_free(&worldGroup);
+    return worldRank;
+}
+
 int MPIWrapper::getNextRank() {
     return (getRank() + 1) % getSize();
 }
@@ -59,17 +330,17 @@ int MPIWrapper::getSize() {
 
 bool MPIWrapper::hasData(int source, int flag, MPI_Status* status) {
     int found;
-    MPI_Iprobe(source, flag, this->world, &found, lastStatus);
+    MPI_Iprobe(source, flag, this->world, &found, currentStatus());
     updateStatus(status);
     return found != 0;
 }
 
 bool MPIWrapper::hasData(int source, int flag) {
-    return hasData(source, flag, this->lastStatus);
+    return hasData(source, flag, currentStatus());
 }
 
 bool MPIWrapper::hasData(int source) {
-    return hasData(source, -1, this->lastStatus);
+    return hasData(source, -1, currentStatus());
 }
 
 bool MPIWrapper::hasData() {
@@ -77,37 +348,161 @@ bool MPIWrapper::hasData() {
 }
 
 void MPIWrapper::updateStatus(MPI_Status* other) {
-    if (this->lastStatus != other) {
-        *other = *(this->lastStatus);
+    if (currentStatus() != other) {
+        *other = *currentStatus();
     }
 }
 
 MPI_Status MPIWrapper::getLastStatus() {
-    return *(this->lastStatus);
+    return *currentStatus();
 }
 
 int MPIWrapper::getLastSource() {
-    return this->lastStatus->MPI_SOURCE;
+    return currentStatus()->MPI_SOURCE;
 }
 
 int MPIWrapper::getLastTag() {
-    return this->lastStatus->MPI_TAG;
+    return currentStatus()->MPI_TAG;
+}
+
+void MPIWrapper::track(std::shared_ptr<MPIRequestState> state) {
+    std::lock_guard<std::mutex> guard(*(this->outstandingLock));
+    std::vector<std::shared_ptr<MPIRequestState>>& pending = *(this->outstanding);
+    size_t kept = 0;
+    for (size_t i = 0; i < pending.size(); i++) {
+        // Only poll requests nobody else can wait on; the rest are reaped
+        // once their owner sees them complete.
+        bool orphaned = pending[i].use_count() == 1;
+        if (pending[i]->isDone() || (orphaned && pending[i]->test())) {
+            continue;
+        }
+        pending[kept++] = pending[i];
+    }
+    pending.resize(kept);
+    pending.push_back(state);
 }
 
-void MPIWrapper::setWorkFunction(std::function<bool (MPIWrapper)> fn) {
+void MPIWrapper::drain() {
+    std::lock_guard<std::mutex> guard(*(this->outstandingLock));
+    waitAllStates(*(this->outstanding));
+    this->outstanding->clear();
+}
+
+void MPIWrapper::waitAllStates(std::vector<std::shared_ptr<MPIRequestState>>& states) {
+    std::vector<MPI_Request> requests(states.size());
+    std::vector<MPI_Status> statuses(states.size());
+    for (size_t i = 0; i < states.size(); i++) {
+        requests[i] = states[i]->request;
+    }
+    double start = profileStart();
+    MPI_Waitall(requests.size(), requests.data(), statuses.data());
+    profileTime(PROFILE_WAIT, start);
+    for (size_t i = 0; i < states.size(); i++) {
+        if (!states[i]->isDone()) {
+            states[i]->complete(statuses[i]);
+        }
+    }
+}
+
+int MPIWrapper::waitAnyStates(std::vector<std::shared_ptr<MPIRequestState>>& states) {
+    std::vector<MPI_Request> requests(states.size());
+    for (size_t i = 0; i < states.size(); i++) {
+        requests[i] = states[i]->request;
+    }
+    int index;
+    double start = profileStart();
+    MPI_Waitany(requests.size(), requests.data(), &index, currentStatus());
+    profileTime(PROFILE_WAIT, start);
+    if (index != MPI_UNDEFINED) {
+        states[index]->complete(*currentStatus());
+    }
+    return index;
+}
+
+std::vector<int> MPIWrapper::testSomeStates(std::vector<std::shared_ptr<MPIRequestState>>& states) {
+    std::vector<MPI_Request> requests(states.size());
+    std::vector<MPI_Status> statuses(states.size());
+    std::vector<int> indices(states.size());
+    for (size_t i = 0; i < states.size(); i++) {
+        requests[i] = states[i]->request;
+    }
+    int completed;
+    MPI_Testsome(requests.size(), requests.data(), &completed, indices.data(), statuses.data());
+    if (completed == MPI_UNDEFINED) {
+        completed = 0;
+    }
+    indices.resize(completed);
+    for (int i = 0; i < completed; i++) {
+        states[indices[i]]->complete(statuses[i]);
+    }
+    return indices;
+}
+
+std::vector<int> MPIWrapper::displacementsOf(const std::vector<int>& counts) {
+    std::vector<int> offsets(counts.size(), 0);
+    for (size_t i = 1; i < counts.size(); i++) {
+        offsets[i] = offsets[i - 1] + counts[i - 1];
+    }
+    return offsets;
+}
+
+std::vector<int> MPIWrapper::blockCounts(int total) {
+    std::vector<int> counts(getSize(), total / getSize());
+    for (int i = 0; i < total % getSize(); i++) {
+        counts[i]++;
+    }
+    return counts;
+}
+
+MPI_Offset MPIWrapper::blockOffset(long count, MPI_Offset& total) {
+    long offset = 0;
+    MPI_Exscan(&count, &offset, 1, MPI_LONG, MPI_SUM, this->world);
+    if (getRank() == 0) {
+        offset = 0;
+    }
+    long sum;
+    long largest;
+    MPI_Allreduce(&count, &sum, 1, MPI_LONG, MPI_SUM, this->world);
+    MPI_Allreduce(&count, &largest, 1, MPI_LONG, MPI_MAX, this->world);
+    if (largest > INT_MAX) {
+        throw std::runtime_error("a block holds more values than one MPI call can transfer");
+    }
+    total = sum;
+    return offset;
+}
+
+int MPIWrapper::fileBlock(MPI_Offset total, MPI_Offset& offset) {
+    // Rank 0's block is the largest, and every process computes it the same.
+    MPI_Offset base = total / getSize();
+    MPI_Offset extra = total % getSize();
+    if (base + (extra > 0) > INT_MAX) {
+        throw std::runtime_error("a block holds more values than one MPI call can transfer");
+    }
+    offset = getRank() * base + std::min<MPI_Offset>(getRank(), extra);
+    return base + (getRank() < extra);
+}
+
+void MPIWrapper::setWorkFunction(std::function<bool (MPIWrapper&)> fn) {
     this->work_fn = fn;
 }
 
 void MPIWrapper::work() {
-    bool done = this->work_fn(*this);
+    if (!this->work_fn) {
+        return;
+    }
+    bool done = false;
     while (!done) {
-        std::cout << "Iterating again..." << std::endl;
+        double start = profileStart();
         done = this->work_fn(*this);
+        traceEvent("work", start);
+        this->progress->pollPoint();
     }
 }
 
 void MPIWrapper::barrier() {
+    double start = profileStart();
     MPI_Barrier(this->world);
+    profileTime(PROFILE_BARRIER, start);
 }
 
 int MPIWrapper::getRandomRank() {
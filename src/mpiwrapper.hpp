@@ -1,30 +1,221 @@
 #ifndef MPI_WRAPPER_HPP
 #define MPI_WRAPPER_HPP
 #include <mpi.h>
+#include <algorithm>
+#include <climits>
 #include <functional>
 #include <queue>
+#include <memory>
+#include <vector>
+#include <array>
+#include <type_traits>
+#include <mutex>
 #include "mpitype.hpp"
+#include "mpirequest.hpp"
+#include "mpiview.hpp"
+#include "mpipool.hpp"
+#include "mpiop.hpp"
+#include "mpiprofile.hpp"
+#include "mpitrace.hpp"
+#include "mpifile.hpp"
+#include "mpishared.hpp"
+#include "mpiwindow.hpp"
+#include "mpiserial.hpp"
+#include "mpiprogress.hpp"
 #include "mpiu.hpp"
 
 #define MCW MPI_COMM_WORLD
 
+#define HIERARCHY_TAG 0x4800
+
 /**
  * MPIWrapper, an MPI Utility class by Hunter Henrichsen and Sally Devitry.
  * 
  * Provides a wrapper around common MPI functions, intitialization, and
  * finalization. Provides sane defaults to functions so that only the bare
  * minimum information is required.
+ * 
+ * Groups: split() makes a child wrapper over a subset of the processes,
+ * with the same API and its own ranks. getNode() and getLeaders() are
+ * cached children for the processes sharing a node and for one process per
+ * node, which the *Hierarchical collectives use to keep most traffic within
+ * a node, and allocateShared and shareTable use to put memory in one place
+ * per node. Only the wrapper constructed with argc and argv finalizes MPI.
+ * 
+ * Threading: by default MPI is initialized without thread support, and only
+ * the thread that constructed the wrapper may use it. Constructing with a
+ * thread level opts in to more:
+ *  - MPI_THREAD_FUNNELED: worker threads may run, but only the main thread
+ *    calls the wrapper.
+ *  - MPI_THREAD_SERIALIZED: any thread may call the wrapper, but the caller
+ *    must ensure no two calls overlap.
+ *  - MPI_THREAD_MULTIPLE: any thread may call the wrapper at any time.
+ * The last status (getLastStatus, getLastSource, getLastTag) is kept per
+ * thread, so it always describes the calling thread's last receive. Work
+ * functions, grid creation, splitting and reductions with function objects
+ * remain single-threaded operations in every mode.
  */
 class MPIWrapper {
 private:
     MPI_Comm world;
+    MPI_Comm grid = MPI_COMM_NULL;
     int size;
     int rank;
     int scopes = 1;
-    std::function<bool (MPIWrapper)> work_fn;
-    MPI_Status* lastStatus;
+    int threadLevel = MPI_THREAD_SINGLE;
+    std::function<bool (MPIWrapper&)> work_fn;
+    std::shared_ptr<std::vector<std::shared_ptr<MPIRequestState>>> outstanding;
+    std::shared_ptr<std::mutex> outstandingLock;
+    std::shared_ptr<MPIProfile> profile;
+    std::shared_ptr<MPITrace> trace;
+    std::shared_ptr<MPIProgress> progress;
+    // Frees the communicator of a wrapper made by split once its last copy
+    // is gone. Empty for the wrapper that owns MPI_COMM_WORLD.
+    std::shared_ptr<MPI_Comm> owned;
+    std::shared_ptr<MPIWrapper> node;
+    std::shared_ptr<MPIWrapper> leaders;
+    // This communicator's ranks in MPI_COMM_WORLD, which the shared profile
+    // and trace count peers by. Empty for the wrapper over MPI_COMM_WORLD.
+    std::shared_ptr<std::vector<int>> worldRanks;
+
+    void init(int argc, char** argv, int requested);
+
+    /**
+     * Makes a wrapper over a communicator split from a parent's. The child
+     * shares the parent's outstanding requests, profile and trace, and never
+     * finalizes MPI.
+     *
+     * @param parent The wrapper the communicator was split from.
+     * @param comm The new communicator, freed with the last copy of the
+     * child.
+     */
+    MPIWrapper(const MPIWrapper& parent, MPI_Comm comm);
 
     void updateStatus(MPI_Status* other); 
+
+    /**
+     * @returns This thread's last status. Kept per thread so that receives
+     * on different threads do not overwrite each other's status.
+     */
+    static MPI_Status*& currentStatus();
+
+    /**
+     * Blocks until every tracked request has completed.
+     */
+    void drain();
+
+    void waitAllStates(std::vector<std::shared_ptr<MPIRequestState>>& states);
+    int waitAnyStates(std::vector<std::shared_ptr<MPIRequestState>>& states);
+    std::vector<int> testSomeStates(std::vector<std::shared_ptr<MPIRequestState>>& states);
+
+    /**
+     * @param counts The number of values held by each rank.
+     *
+     * @returns The offset of each rank's values when laid end to end.
+     */
+    static std::vector<int> displacementsOf(const std::vector<int>& counts);
+
+    /**
+     * @param total The number of values to split between ranks.
+     *
+     * @returns How many values each rank holds in a block distribution,
+     * with lower ranks taking the remainder.
+     */
+    std::vector<int> blockCounts(int total);
+
+    /**
+     * @param count The number of values this process holds.
+     * @param total Set to the number of values across every process.
+     *
+     * @returns The index of this process's first value when every process's
+     * values are laid end to end in rank order.
+     *
+     * @throws std::runtime_error On every process, if any process holds
+     * more values than one MPI call can transfer (INT_MAX).
+     */
+    MPI_Offset blockOffset(long count, MPI_Offset& total);
+
+    /**
+     * Splits values laid end to end into even blocks, one per process, with
+     * lower ranks taking the remainder as in blockCounts. Unlike
+     * blockCounts, the total may exceed what an int holds.
+     *
+     * @param total The number of values to split.
+     * @param offset Set to the index of this process's first value.
+     *
+     * @returns The number of values in this process's block.
+     *
+     * @throws std::runtime_error On every process, if a block holds more
+     * values than one MPI call can transfer (INT_MAX).
+     */
+    int fileBlock(MPI_Offset total, MPI_Offset& offset);
+
+    /**
+     * @returns The time to measure a call from, or 0 when neither profiling
+     * nor tracing.
+     */
+    double profileStart() {
+        return this->profile->isEnabled() || this->trace->isEnabled() ? MPI_Wtime() : 0;
+    }
+
+    /**
+     * Records a completed send when profiling or tracing.
+     *
+     * @param peer The rank the message went to.
+     * @param bytes The size of the message.
+     * @param start The value of profileStart() before the send.
+     */
+    void profileSend(int peer, long bytes, double start);
+
+    /**
+     * Records a completed receive when profiling or tracing, taking the peer
+     * and size from the status.
+     *
+     * @param status The status of the receive.
+     * @param start The value of profileStart() before the receive.
+     */
+    void profileReceive(MPI_Status* status, double start);
+
+    /**
+     * Counts a completed non-blocking receive when profiling. The time is
+     * counted as waiting instead.
+     *
+     * @param status The status of the receive.
+     */
+    void profileArrival(MPI_Status* status);
+
+    /**
+     * @param peer A rank in this wrapper's communicator.
+     *
+     * @returns The same process's rank in MPI_COMM_WORLD, or peer itself if
+     * it is not a process (such as MPI_PROC_NULL).
+     */
+    int worldRank(int peer);
+
+    /**
+     * @returns A callback for receive requests that counts the message
+     * when it arrives, whichever call completes the request. Holds the
+     * profile, not the wrapper, so it may outlive the wrapper.
+     */
+    std::function<void (const MPI_Status&)> arrivalHook();
+
+    /**
+     * Records time spent in a call when profiling or tracing.
+     *
+     * @param category What the time was spent on.
+     * @param start The value of profileStart() before the call.
+     */
+    void profileTime(MPIProfileCategory category, double start);
+
+    template<typename R>
+    static std::vector<std::shared_ptr<MPIRequestState>> statesOf(std::vector<R>& requests) {
+        std::vector<std::shared_ptr<MPIRequestState>> states;
+        states.reserve(requests.size());
+        for (R& request : requests) {
+            states.push_back(request.getState());
+        }
+        return states;
+    }
 public:
     // Basic setup
     /**
@@ -35,6 +226,18 @@ public:
      * @param argv The vector of command-line arguments.
      */
     MPIWrapper(int argc, char** argv);
+
+    /**
+     * Constructor with thread support. Sets up the MPI process with the
+     * requested thread level, fills rank and size, and establishes status
+     * monitorring. See the class documentation for what each level allows.
+     * 
+     * @param argc The number of arguments in argv.
+     * @param argv The vector of command-line arguments.
+     * @param threadLevel The thread level to request, such as
+     * MPI_THREAD_MULTIPLE.
+     */
+    MPIWrapper(int argc, char** argv, int threadLevel);
     MPIWrapper(const MPIWrapper& other);
 
     /**
@@ -43,6 +246,122 @@ public:
      */
     ~MPIWrapper();
 
+    /**
+     * @returns The communicator this wrapper sends and receives on.
+     * 
+     * @order O(1).
+     */
+    MPI_Comm getComm();
+
+    /**
+     * Splits the processes into groups, each with a wrapper of its own.
+     * Must be called on every process.
+     * 
+     * @param color Which group this process joins. Must not be negative.
+     * @param key Orders the ranks within a group, ties broken by rank here.
+     * Defaults to 0.
+     * 
+     * @return A wrapper over this process's group. Its ranks and sizes are
+     * its own; its traffic is counted in the shared profile by
+     * MPI_COMM_WORLD rank, so it appears in the report at finalize.
+     */
+    MPIWrapper split(int color, int key=0);
+
+    /**
+     * @returns A wrapper over the processes that share this process's node
+     * (MPI_COMM_TYPE_SHARED), made on first use. The first call must be
+     * made on every process.
+     */
+    MPIWrapper& getNode();
+
+    /**
+     * @returns A wrapper over the first process of each node, made on first
+     * use. Processes that do not lead their node get a wrapper over the
+     * other non-leaders, which the hierarchical collectives never use. The
+     * first call must be made on every process.
+     */
+    MPIWrapper& getLeaders();
+
+    /**
+     * @returns If this process is the first on its node.
+     */
+    bool isNodeLeader();
+
+    /**
+     * Turns communication profiling on or off. When on, messages, bytes and
+     * blocked time are counted per peer and printed when MPI is finalized.
+     * Also enabled by setting MPI_WRAPPER_PROFILE=1 in the environment. Must
+     * be set the same way on every process, since the report is collective.
+     * 
+     * @param enabled Whether to collect counters.
+     */
+    void setProfiling(bool enabled);
+
+    /**
+     * @returns The communication counters for this process.
+     */
+    MPIProfile& getProfile();
+
+    /**
+     * Merges and prints every process's communication counters, including
+     * traffic on split communicators, from rank 0 of MPI_COMM_WORLD.
+     * Must be called on every process.
+     */
+    void reportProfile();
+
+    /**
+     * Starts recording a timeline of every send, receive, wait, barrier,
+     * collective and work iteration, written as Chrome trace JSON when MPI
+     * is finalized. Also enabled by setting MPI_WRAPPER_TRACE=path in the
+     * environment. Must be set the same way on every process, since writing
+     * the trace is collective.
+     * 
+     * @param path The file for rank 0 to write the merged trace to, or an
+     * empty string to stop recording.
+     */
+    void setTracing(std::string path);
+
+    /**
+     * @returns The event buffer for this process.
+     */
+    MPITrace& getTrace();
+
+    /**
+     * Merges every process's events and writes them from rank 0. Must be
+     * called on every process.
+     */
+    void writeTrace();
+
+    /**
+     * @returns The progress engine shared by this wrapper and its copies and
+     * children. Hand it requests to keep them moving during long compute
+     * phases, from a background thread (start, which needs
+     * MPI_THREAD_MULTIPLE) or at polling points; work() and MPIIterator
+     * poll it between steps.
+     */
+    MPIProgress& getProgress();
+
+    /**
+     * @returns The pool that receive buffers are drawn from.
+     */
+    MPIBufferPool& getBufferPool();
+
+    /**
+     * Records a span of user code on the timeline when tracing.
+     * 
+     * @param name What the span was, as a string literal.
+     * @param start When the span began, from MPI_Wtime.
+     */
+    void traceEvent(const char* name, double start);
+
+    /**
+     * @returns The thread level MPI actually provided, which may be lower
+     * than the one requested.
+     * 
+     * @order O(1).
+     */
+    int getThreadLevel();
+
     // Ranks
 
     /**
@@ -98,6 +417,59 @@ public:
      */
     int getCubeRank(const int dimension);
 
+    // Cartesian grid
+
+    /**
+     * Arranges the processes into a Cartesian grid. MPI may renumber
+     * processes within the grid so that neighbors sit close together.
+     * 
+     * @param dims The number of processes along each dimension. Zeros are
+     * filled in with a balanced split of the remaining processes.
+     * @param periodic Whether each dimension wraps around. Defaults to no
+     * wrapping in any dimension.
+     * @param reorder Whether MPI may renumber processes. Defaults to true.
+     */
+    void createGrid(std::vector<int> dims, std::vector<bool> periodic=std::vector<bool>(), bool reorder=true);
+
+    /**
+     * @returns The grid communicator, or MPI_COMM_NULL if no grid was
+     * created.
+     */
+    MPI_Comm getGrid();
+
+    /**
+     * @returns The number of processes along each dimension of the grid.
+     * 
+     * @order O(d).
+     */
+    std::vector<int> getGridShape();
+
+    /**
+     * @returns The coordinates of this process within the grid.
+     * 
+     * @order O(d).
+     */
+    std::vector<int> getGridCoords();
+
+    /**
+     * @returns The rank of this process within the grid communicator.
+     * 
+     * @order O(1).
+     */
+    int getGridRank();
+
+    /**
+     * @param dimension The dimension to move along.
+     * @param offset How far to move; negative moves toward lower coordinates.
+     * 
+     * @returns The rank of the process offset steps along the dimension,
+     * usable with this wrapper's send and receive, or MPI_PROC_NULL past the
+     * edge of a non-periodic dimension.
+     * 
+     * @order O(1).
+     */
+    int getGridNeighbor(const int dimension, const int offset=1);
+
     // Barrier
 
     /**
@@ -163,8 +535,7 @@ public:
      */
     template<typename T>
     void send(const T& value, const int& destination, const int& tag=0) {
-        T tmp = value;
-        MPI_Send(&tmp, 1, mpi_type<T>::get(), destination, tag, this->world);
+        sendMultiple<T>(&value, 1, destination, tag);
     }
 
     /**
@@ -203,7 +574,9 @@ public:
      */
     template<typename T>
     void sendMultiple(const T* values, const int& count, const int& destination, const int& tag=0) {
-        MPI_Send(&values, count, mpi_type<T>::get(), destination, tag, this->world);
+        double start = profileStart();
+        MPI_Send(values, count, mpi_type<T>::get(), destination, tag, this->world);
+        profileSend(destination, count * sizeof(T), start);
     }
 
     /**
@@ -230,7 +603,51 @@ public:
      */
     template<typename T>
     void sendMultipleCube(const T* values, const int& count, const int& dimension, const int& tag=0) {
-        sendMultiple<T>(&values, count, mpi_type<T>::get(), getCubeRank(dimension), tag, this->world);
+        sendMultiple<T>(values, count, getCubeRank(dimension), tag);
+    }
+
+    /**
+     * Sends every value in a vector from one process to another, directly
+     * from the vector's storage.
+     * 
+     * @param values The values to send to the specified process.
+     * @param destination The rank of the specified process.
+     * @param tag The tag to send the value with. Defaults to 0.
+     * @param T The MPI-supported type to send.
+     */
+    template<typename T>
+    void sendMultiple(const std::vector<T>& values, const int& destination, const int& tag=0) {
+        sendMultiple<T>(values.data(), values.size(), destination, tag);
+    }
+
+    /**
+     * Sends every value in an array from one process to another, directly
+     * from the array's storage.
+     * 
+     * @param values The values to send to the specified process.
+     * @param destination The rank of the specified process.
+     * @param tag The tag to send the value with. Defaults to 0.
+     * @param T The MPI-supported type to send.
+     * @param N The length of the array.
+     */
+    template<typename T, size_t N>
+    void sendMultiple(const std::array<T, N>& values, const int& destination, const int& tag=0) {
+        sendMultiple<T>(values.data(), N, destination, tag);
+    }
+
+    /**
+     * Sends every value in a view from one process to another, directly from
+     * the viewed storage.
+     * 
+     * @param values The values to send to the specified process.
+     * @param destination The rank of the specified process.
+     * @param tag The tag to send the value with. Defaults to 0.
+     * @param T The MPI-supported type to send.
+     */
+    template<typename T>
+    void sendMultiple(const MPIView<T>& values, const int& destination, const int& tag=0) {
+        typedef typename std::remove_const<T>::type U;
+        sendMultiple<U>(values.data(), values.size(), destination, tag);
     }
 
     /**
@@ -247,7 +664,9 @@ public:
     template<typename T>
     T receive(const int& source, const int& tag, MPI_Status*& status) {
         T tmp;
-        MPI_Recv(&tmp, 1, mpi_type<T>::get(), source, tag, this->world, this->lastStatus);
+        double start = profileStart();
+        MPI_Recv(&tmp, 1, mpi_type<T>::get(), source, tag, this->world, currentStatus());
+        profileReceive(currentStatus(), start);
         updateStatus(status);
         return tmp;
     }
@@ -264,7 +683,7 @@ public:
      */
     template<typename T>
     T receive(const int& source=MPI_ANY_SOURCE, const int& tag=MPI_ANY_TAG) {
-        return receive<T>(source, tag, lastStatus);
+        return receive<T>(source, tag, currentStatus());
     }
 
     /**
@@ -293,12 +712,13 @@ public:
      */
     template<typename T>
     T receiveTagged(const int& tag) {
-        return receive<T>(MPI_ANY_SOURCE, tag, lastStatus);
+        return receive<T>(MPI_ANY_SOURCE, tag, currentStatus());
     }
 
     /**
      * Receives multiple value from the given source with the given tag and
-     * returns it, placing the status in the given status.
+     * returns it, placing the status in the given status. The buffer comes
+     * from the shared buffer pool and goes back to it when dropped.
      * 
      * @param count The number of values to receive.
      * @param source The source to receive the value from.
@@ -306,12 +726,14 @@ public:
      * @param status The status reference to place the status in.
      * @param T The MPI-supported type to receive.
      * 
-     * @return The value that was received.
+     * @return The values that were received.
      */
     template<typename T>
-    T* receiveMultiple(const int& count, const int& source, const int& tag, MPI_Status*& status) {
-        T* tmp = new T[count];
-        MPI_Recv(&tmp, count, mpi_type<T>::get(), source, tag, this->world, this->lastStatus);
+    MPIBuffer<T> receiveMultiple(const int& count, const int& source, const int& tag, MPI_Status*& status) {
+        MPIBuffer<T> tmp = MPIBufferPool::shared().acquire<T>(count);
+        double start = profileStart();
+        MPI_Recv(tmp.data(), count, mpi_type<T>::get(), source, tag, this->world, currentStatus());
+        profileReceive(currentStatus(), start);
         updateStatus(status);
         return tmp;
     }
@@ -325,11 +747,11 @@ public:
      * @param tag The tag that the received value must match. Defaults to allow any.
      * @param T The MPI-supported type to receive.
      * 
-     * @return The value that was received.
+     * @return The values that were received.
      */
     template<typename T>
-    T* receiveMultiple(const int& count, const int& source=MPI_ANY_SOURCE, const int& tag=MPI_ANY_TAG) {
-        return receiveMultiple<T>(count, source, tag, lastStatus);
+    MPIBuffer<T> receiveMultiple(const int& count, const int& source=MPI_ANY_SOURCE, const int& tag=MPI_ANY_TAG) {
+        return receiveMultiple<T>(count, source, tag, currentStatus());
     }
 
     /**
@@ -341,10 +763,10 @@ public:
      * @param status The status reference to place the status in.
      * @param T The MPI-supported type to receive.
      * 
-     * @return The value that was received.
+     * @return The values that were received.
      */
     template<typename T>
-    T* receiveMultipleTagged(const int& count, const int& tag, MPI_Status*& status) {
+    MPIBuffer<T> receiveMultipleTagged(const int& count, const int& tag, MPI_Status*& status) {
         return receiveMultiple<T>(count, MPI_ANY_SOURCE, tag, status);
     }
 
@@ -356,11 +778,1193 @@ public:
      * @param tag The tag that the received value must match. Defaults to allow any.
      * @param T The MPI-supported type to receive.
      * 
+     * @return The values that were received.
+     */
+    template<typename T>
+    MPIBuffer<T> receiveMultipleTagged(const int& count, const int& tag) {
+        return receiveMultiple<T>(count, MPI_ANY_SOURCE, tag, currentStatus());
+    }
+
+    /**
+     * Waits for a message from the given source with the given tag without
+     * receiving it, and reports how many values it holds.
+     * 
+     * @param source The source to wait for. Defaults to allow any.
+     * @param tag The tag that the message must match. Defaults to allow any.
+     * @param T The MPI-supported type of the message.
+     * 
+     * @return The number of values in the waiting message.
+     */
+    template<typename T>
+    int probe(const int& source=MPI_ANY_SOURCE, const int& tag=MPI_ANY_TAG) {
+        int count;
+        MPI_Probe(source, tag, this->world, currentStatus());
+        MPI_Get_count(currentStatus(), mpi_type<T>::get(), &count);
+        return count;
+    }
+
+    /**
+     * Receives a message of any length into a vector, resizing it to fit.
+     * The message is sized with a matched probe, so the sender does not need
+     * to send the count first. Reusing the same vector across calls avoids
+     * reallocating once it has grown large enough.
+     * 
+     * @param values The vector to receive into.
+     * @param source The source to receive the values from. Defaults to allow any.
+     * @param tag The tag that the received values must match. Defaults to allow any.
+     * @param T The MPI-supported type to receive.
+     * 
+     * @return The number of values received.
+     */
+    template<typename T>
+    int receiveMultiple(std::vector<T>& values, const int& source=MPI_ANY_SOURCE, const int& tag=MPI_ANY_TAG) {
+        int count;
+        MPI_Message message;
+        double start = profileStart();
+        MPI_Mprobe(source, tag, this->world, &message, currentStatus());
+        MPI_Get_count(currentStatus(), mpi_type<T>::get(), &count);
+        values.resize(count);
+        MPI_Mrecv(values.data(), count, mpi_type<T>::get(), &message, currentStatus());
+        profileReceive(currentStatus(), start);
+        return count;
+    }
+
+    /**
+     * Receives up to N values into an array.
+     * 
+     * @param values The array to receive into.
+     * @param source The source to receive the values from. Defaults to allow any.
+     * @param tag The tag that the received values must match. Defaults to allow any.
+     * @param T The MPI-supported type to receive.
+     * @param N The length of the array.
+     * 
+     * @return The number of values received.
+     */
+    template<typename T, size_t N>
+    int receiveMultiple(std::array<T, N>& values, const int& source=MPI_ANY_SOURCE, const int& tag=MPI_ANY_TAG) {
+        return receiveMultiple<T>(MPIView<T>(values), source, tag);
+    }
+
+    /**
+     * Receives up to as many values as fit in the view.
+     * 
+     * @param values The view to receive into.
+     * @param source The source to receive the values from. Defaults to allow any.
+     * @param tag The tag that the received values must match. Defaults to allow any.
+     * @param T The MPI-supported type to receive.
+     * 
+     * @return The number of values received.
+     */
+    template<typename T>
+    int receiveMultiple(const MPIView<T>& values, const int& source=MPI_ANY_SOURCE, const int& tag=MPI_ANY_TAG) {
+        int count;
+        double start = profileStart();
+        MPI_Recv(values.data(), values.size(), mpi_type<T>::get(), source, tag, this->world, currentStatus());
+        profileReceive(currentStatus(), start);
+        MPI_Get_count(currentStatus(), mpi_type<T>::get(), &count);
+        return count;
+    }
+
+    /**
+     * Receives a message of any length into a new vector.
+     * 
+     * @param source The source to receive the values from. Defaults to allow any.
+     * @param tag The tag that the received values must match. Defaults to allow any.
+     * @param T The MPI-supported type to receive.
+     * 
+     * @return The values that were received.
+     */
+    template<typename T>
+    std::vector<T> receiveVector(const int& source=MPI_ANY_SOURCE, const int& tag=MPI_ANY_TAG) {
+        std::vector<T> values;
+        receiveMultiple<T>(values, source, tag);
+        return values;
+    }
+
+    /**
+     * Sends a value of any serializable type (see mpiserial.hpp), such as a
+     * string, a map, or a vector of records, as one message of bytes.
+     * 
+     * @param value The value to send to the specified process.
+     * @param destination The rank of the specified process.
+     * @param tag The tag to send the value with. Defaults to 0.
+     * @param T The serializable type to send.
+     */
+    template<typename T>
+    void sendSerialized(const T& value, const int& destination, const int& tag=0) {
+        MPISerializer out = mpi_serialize(value);
+        double start = profileStart();
+        MPI_Send(out.data(), out.size(), MPI_BYTE, destination, tag, this->world);
+        profileSend(destination, out.size(), start);
+    }
+
+    /**
+     * Receives a value sent with sendSerialized. The message is probed for
+     * its size and received once into a pooled buffer, so no size needs to
+     * be sent ahead of it.
+     * 
+     * @param source The source to receive the value from.
+     * @param tag The tag that the received value must match.
+     * @param status The status reference to place the status in.
+     * @param T The serializable type to receive.
+     * 
+     * @return The value that was received.
+     * 
+     * @throws std::runtime_error If the message does not hold one T.
+     */
+    template<typename T>
+    T receiveSerialized(const int& source, const int& tag, MPI_Status*& status) {
+        int count;
+        MPI_Message message;
+        double start = profileStart();
+        MPI_Mprobe(source, tag, this->world, &message, currentStatus());
+        MPI_Get_count(currentStatus(), MPI_BYTE, &count);
+        MPIBuffer<char> buffer = getBufferPool().acquire<char>(count);
+        MPI_Mrecv(buffer.data(), count, MPI_BYTE, &message, currentStatus());
+        profileReceive(currentStatus(), start);
+        updateStatus(status);
+        return mpi_deserialize<T>(buffer.data(), count);
+    }
+
+    /**
+     * Receives a value sent with sendSerialized.
+     * 
+     * @param source The source to receive the value from. Defaults to allow any.
+     * @param tag The tag that the received value must match. Defaults to allow any.
+     * @param T The serializable type to receive.
+     * 
      * @return The value that was received.
+     * 
+     * @throws std::runtime_error If the message does not hold one T.
+     */
+    template<typename T>
+    T receiveSerialized(const int& source=MPI_ANY_SOURCE, const int& tag=MPI_ANY_TAG) {
+        return receiveSerialized<T>(source, tag, currentStatus());
+    }
+
+    // Non-blocking communication
+
+    /**
+     * Starts sending a value from one process to another without waiting for
+     * it to be delivered. The value is copied into the request.
+     * 
+     * @param value The value to send to the specified process.
+     * @param destination The rank of the specified process.
+     * @param tag The tag to send the value with. Defaults to 0.
+     * @param T The MPI-supported type to send.
+     * 
+     * @return A handle to the outstanding send.
+     */
+    template<typename T>
+    MPIRequest<T> isend(const T& value, const int& destination, const int& tag=0) {
+        std::shared_ptr<MPITypedRequestState<T>> state(new MPITypedRequestState<T>());
+        state->buffer.push_back(value);
+        double start = profileStart();
+        MPI_Isend(state->buffer.data(), 1, mpi_type<T>::get(), destination, tag, this->world, &state->request);
+        profileSend(destination, sizeof(T), start);
+        track(state);
+        return MPIRequest<T>(state);
+    }
+
+    /**
+     * Starts sending a value to the next process using a ring topology.
+     * 
+     * @param value The value to send to the next process.
+     * @param tag The tag to send the value with. Defaults to 0.
+     * @param T The MPI-supported type to send.
+     * 
+     * @return A handle to the outstanding send.
+     */
+    template<typename T>
+    MPIRequest<T> isendRing(const T& value, const int& tag=0) {
+        return isend<T>(value, getNextRank(), tag);
+    }
+
+    /**
+     * Starts sending a value from one process to another in a cube topology.
+     * 
+     * @param value The value to send to the next process.
+     * @param dimension The cube dimension to send value along.
+     * @param tag The tag to send the value with. Defaults to 0.
+     * @param T The MPI-supported type to send.
+     * 
+     * @return A handle to the outstanding send.
+     */
+    template<typename T>
+    MPIRequest<T> isendCube(const T& value, const int& dimension, const int& tag=0) {
+        return isend<T>(value, getCubeRank(dimension), tag);
+    }
+
+    /**
+     * Starts sending values from one process to another. The values are sent
+     * directly from the caller's storage, which must stay valid and unchanged
+     * until the request completes.
+     * 
+     * @param values The values to send to the specified process.
+     * @param count The number of values being sent.
+     * @param destination The rank of the specified process.
+     * @param tag The tag to send the value with. Defaults to 0.
+     * @param T The MPI-supported type to send.
+     * 
+     * @return A handle to the outstanding send.
+     */
+    template<typename T>
+    MPIRequest<T> isendMultiple(const T* values, const int& count, const int& destination, const int& tag=0) {
+        std::shared_ptr<MPITypedRequestState<T>> state(new MPITypedRequestState<T>());
+        double start = profileStart();
+        MPI_Isend(values, count, mpi_type<T>::get(), destination, tag, this->world, &state->request);
+        profileSend(destination, count * sizeof(T), start);
+        track(state);
+        return MPIRequest<T>(state);
+    }
+
+    /**
+     * Starts sending every value in a vector, directly from the vector's
+     * storage, which must stay valid until the request completes.
+     * 
+     * @param values The values to send to the specified process.
+     * @param destination The rank of the specified process.
+     * @param tag The tag to send the value with. Defaults to 0.
+     * @param T The MPI-supported type to send.
+     * 
+     * @return A handle to the outstanding send.
+     */
+    template<typename T>
+    MPIRequest<T> isendMultiple(const std::vector<T>& values, const int& destination, const int& tag=0) {
+        return isendMultiple<T>(values.data(), values.size(), destination, tag);
+    }
+
+    /**
+     * Starts sending every value in a view, directly from the viewed storage,
+     * which must stay valid until the request completes.
+     * 
+     * @param values The values to send to the specified process.
+     * @param destination The rank of the specified process.
+     * @param tag The tag to send the value with. Defaults to 0.
+     * @param T The MPI-supported type to send.
+     * 
+     * @return A handle to the outstanding send.
+     */
+    template<typename T>
+    MPIRequest<typename std::remove_const<T>::type> isendMultiple(const MPIView<T>& values, const int& destination, const int& tag=0) {
+        typedef typename std::remove_const<T>::type U;
+        return isendMultiple<U>(values.data(), values.size(), destination, tag);
+    }
+
+    /**
+     * Starts sending values from one process to another in a ring topology.
+     * 
+     * @param values The values to send to the next process.
+     * @param count The number of values being sent.
+     * @param tag The tag to send the value with. Defaults to 0.
+     * @param T The MPI-supported type to send.
+     * 
+     * @return A handle to the outstanding send.
+     */
+    template<typename T>
+    MPIRequest<T> isendMultipleRing(const T* values, const int& count, const int& tag=0) {
+        return isendMultiple<T>(values, count, getNextRank(), tag);
+    }
+
+    /**
+     * Starts sending values from one process to another in a cube topology.
+     * 
+     * @param values The values to send to the next process.
+     * @param count The number of values being sent.
+     * @param dimension The cube dimension to send value along.
+     * @param tag The tag to send the value with. Defaults to 0.
+     * @param T The MPI-supported type to send.
+     * 
+     * @return A handle to the outstanding send.
+     */
+    template<typename T>
+    MPIRequest<T> isendMultipleCube(const T* values, const int& count, const int& dimension, const int& tag=0) {
+        return isendMultiple<T>(values, count, getCubeRank(dimension), tag);
+    }
+
+    /**
+     * Starts receiving a value from the given source with the given tag.
+     * 
+     * @param source The source to receive the value from. Defaults to allow any.
+     * @param tag The tag that the received value must match. Defaults to allow any.
+     * @param T The MPI-supported type to receive.
+     * 
+     * @return A handle whose get() yields the received value.
+     */
+    template<typename T>
+    MPIRequest<T> irecv(const int& source=MPI_ANY_SOURCE, const int& tag=MPI_ANY_TAG) {
+        return irecvMultiple<T>(1, source, tag);
+    }
+
+    /**
+     * Starts receiving a value from any source with the given tag.
+     * 
+     * @param tag The tag that the received value must match.
+     * @param T The MPI-supported type to receive.
+     * 
+     * @return A handle whose get() yields the received value.
+     */
+    template<typename T>
+    MPIRequest<T> irecvTagged(const int& tag) {
+        return irecv<T>(MPI_ANY_SOURCE, tag);
+    }
+
+    /**
+     * Starts receiving up to count values from the given source with the
+     * given tag.
+     * 
+     * @param count The maximum number of values to receive.
+     * @param source The source to receive the values from. Defaults to allow any.
+     * @param tag The tag that the received values must match. Defaults to allow any.
+     * @param T The MPI-supported type to receive.
+     * 
+     * @return A handle whose getAll() yields the received values.
+     */
+    template<typename T>
+    MPIRequest<T> irecvMultiple(const int& count, const int& source=MPI_ANY_SOURCE, const int& tag=MPI_ANY_TAG) {
+        std::shared_ptr<MPITypedRequestState<T>> state(new MPITypedRequestState<T>());
+        state->buffer.resize(count);
+        state->arrival = arrivalHook();
+        MPI_Irecv(state->buffer.data(), count, mpi_type<T>::get(), source, tag, this->world, &state->request);
+        track(state);
+        return MPIRequest<T>(state);
+    }
+
+    /**
+     * Starts receiving up to count values from any source with the given tag.
+     * 
+     * @param count The maximum number of values to receive.
+     * @param tag The tag that the received values must match.
+     * @param T The MPI-supported type to receive.
+     * 
+     * @return A handle whose getAll() yields the received values.
+     */
+    template<typename T>
+    MPIRequest<T> irecvMultipleTagged(const int& count, const int& tag) {
+        return irecvMultiple<T>(count, MPI_ANY_SOURCE, tag);
+    }
+
+    /**
+     * Keeps a request alive until it completes, so that its buffer is not
+     * freed if the caller drops the handle, and waits for it when MPI is
+     * finalized. Requests the wrapper starts are tracked already; track
+     * one started directly with MPI (such as MPI_Ibcast) to give it the
+     * same guarantee. Also reaps completed requests that only the wrapper
+     * still refers to.
+     *
+     * @param state The request to track.
+     */
+    void track(std::shared_ptr<MPIRequestState> state);
+
+    /**
+     * Blocks until every request in the set has completed.
+     * 
+     * @param requests The requests to wait on.
+     * @param R The request handle type.
+     */
+    template<typename R>
+    void waitAll(std::vector<R>& requests) {
+        std::vector<std::shared_ptr<MPIRequestState>> states = statesOf(requests);
+        waitAllStates(states);
+    }
+
+    /**
+     * Blocks until any one request in the set has completed. The status of
+     * that request becomes the last status.
+     * 
+     * @param requests The requests to wait on.
+     * @param R The request handle type.
+     * 
+     * @return The index of the completed request, or MPI_UNDEFINED if every
+     * request had already completed.
+     */
+    template<typename R>
+    int waitAny(std::vector<R>& requests) {
+        std::vector<std::shared_ptr<MPIRequestState>> states = statesOf(requests);
+        return waitAnyStates(states);
+    }
+
+    /**
+     * Checks which requests in the set have completed without blocking.
+     * 
+     * @param requests The requests to check.
+     * @param R The request handle type.
+     * 
+     * @return The indices of the requests that completed during this call.
+     */
+    template<typename R>
+    std::vector<int> testSome(std::vector<R>& requests) {
+        std::vector<std::shared_ptr<MPIRequestState>> states = statesOf(requests);
+        return testSomeStates(states);
+    }
+
+    // Collectives
+
+    /**
+     * Sends a value from the root to every process.
+     * 
+     * @param value The value to send on the root, and the value to fill
+     * everywhere else.
+     * @param root The rank to broadcast from. Defaults to 0.
+     * @param T The MPI-supported type to broadcast.
+     */
+    template<typename T>
+    void broadcast(T& value, const int& root=0) {
+        double start = profileStart();
+        MPI_Bcast(&value, 1, mpi_type<T>::get(), root, this->world);
+        profileTime(PROFILE_COLLECTIVE, start);
+    }
+
+    /**
+     * Sends a vector from the root to every process, resizing it elsewhere to
+     * match the root.
+     * 
+     * @param values The values to send on the root, and the vector to fill
+     * everywhere else.
+     * @param root The rank to broadcast from. Defaults to 0.
+     * @param T The MPI-supported type to broadcast.
+     */
+    template<typename T>
+    void broadcastMultiple(std::vector<T>& values, const int& root=0) {
+        int count = values.size();
+        double start = profileStart();
+        MPI_Bcast(&count, 1, MPI_INT, root, this->world);
+        profileTime(PROFILE_COLLECTIVE, start);
+        values.resize(count);
+        start = profileStart();
+        MPI_Bcast(values.data(), count, mpi_type<T>::get(), root, this->world);
+        profileTime(PROFILE_COLLECTIVE, start);
+    }
+
+    /**
+     * Sends a value of any serializable type (see mpiserial.hpp) from the
+     * root to every process. Broadcasts cannot be probed, so the size of the
+     * serialized value goes first.
+     * 
+     * @param value The value to send on the root, and the value to replace
+     * everywhere else.
+     * @param root The rank to broadcast from. Defaults to 0.
+     * @param T The serializable type to broadcast.
+     * 
+     * @throws std::runtime_error If the bytes received do not hold one T.
+     */
+    template<typename T>
+    void broadcastSerialized(T& value, const int& root=0) {
+        MPISerializer out;
+        if (getRank() == root) {
+            out & value;
+        }
+        int count = out.size();
+        double start = profileStart();
+        MPI_Bcast(&count, 1, MPI_INT, root, this->world);
+        if (getRank() == root) {
+            MPI_Bcast(const_cast<char*>(out.data()), count, MPI_BYTE, root, this->world);
+            profileTime(PROFILE_COLLECTIVE, start);
+            return;
+        }
+        MPIBuffer<char> buffer = getBufferPool().acquire<char>(count);
+        MPI_Bcast(buffer.data(), count, MPI_BYTE, root, this->world);
+        profileTime(PROFILE_COLLECTIVE, start);
+        value = mpi_deserialize<T>(buffer.data(), count);
+    }
+
+    /**
+     * Combines a value from every process into the root.
+     * 
+     * @param value This process's contribution.
+     * @param op The operation to combine values with, such as MPI_SUM.
+     * @param root The rank to collect the result on. Defaults to 0.
+     * @param T The MPI-supported type to reduce.
+     * 
+     * @return The combined value on the root. Unspecified elsewhere.
+     */
+    template<typename T>
+    T reduce(const T& value, MPI_Op op, const int& root=0) {
+        T result = value;
+        double start = profileStart();
+        MPI_Reduce(&value, &result, 1, mpi_type<T>::get(), op, root, this->world);
+        profileTime(PROFILE_COLLECTIVE, start);
+        return result;
+    }
+
+    /**
+     * Combines a value from every process into the root using a function.
+     * The function must be associative and commutative.
+     * 
+     * @param value This process's contribution.
+     * @param fn The function to combine values with, as T(const T&, const T&).
+     * @param root The rank to collect the result on. Defaults to 0.
+     * @param T The MPI-supported type to reduce.
+     * 
+     * @return The combined value on the root. Unspecified elsewhere.
+     */
+    template<typename T, typename F>
+    T reduce(const T& value, const F& fn, const int& root=0) {
+        return reduce<T>(value, mpi_lambda_op<T, F>::get(fn), root);
+    }
+
+    /**
+     * Combines vectors from every process element by element into the root.
+     * Every process must pass the same number of values.
+     * 
+     * @param values This process's contribution.
+     * @param op The operation to combine values with, such as MPI_SUM.
+     * @param root The rank to collect the result on. Defaults to 0.
+     * @param T The MPI-supported type to reduce.
+     * 
+     * @return The combined values on the root. Unspecified elsewhere.
+     */
+    template<typename T>
+    std::vector<T> reduceMultiple(const std::vector<T>& values, MPI_Op op, const int& root=0) {
+        std::vector<T> result(values);
+        double start = profileStart();
+        MPI_Reduce(values.data(), result.data(), values.size(), mpi_type<T>::get(), op, root, this->world);
+        profileTime(PROFILE_COLLECTIVE, start);
+        return result;
+    }
+
+    /**
+     * Combines vectors from every process element by element into the root
+     * using a function. The function must be associative and commutative.
+     * 
+     * @param values This process's contribution.
+     * @param fn The function to combine values with, as T(const T&, const T&).
+     * @param root The rank to collect the result on. Defaults to 0.
+     * @param T The MPI-supported type to reduce.
+     * 
+     * @return The combined values on the root. Unspecified elsewhere.
+     */
+    template<typename T, typename F>
+    std::vector<T> reduceMultiple(const std::vector<T>& values, const F& fn, const int& root=0) {
+        return reduceMultiple<T>(values, mpi_lambda_op<T, F>::get(fn), root);
+    }
+
+    /**
+     * Combines a value from every process and gives the result to all of
+     * them.
+     * 
+     * @param value This process's contribution.
+     * @param op The operation to combine values with, such as MPI_SUM.
+     * @param T The MPI-supported type to reduce.
+     * 
+     * @return The combined value.
+     */
+    template<typename T>
+    T allreduce(const T& value, MPI_Op op) {
+        T result;
+        double start = profileStart();
+        MPI_Allreduce(&value, &result, 1, mpi_type<T>::get(), op, this->world);
+        profileTime(PROFILE_COLLECTIVE, start);
+        return result;
+    }
+
+    /**
+     * Combines a value from every process using a function and gives the
+     * result to all of them. The function must be associative and
+     * commutative.
+     * 
+     * @param value This process's contribution.
+     * @param fn The function to combine values with, as T(const T&, const T&).
+     * @param T The MPI-supported type to reduce.
+     * 
+     * @return The combined value.
+     */
+    template<typename T, typename F>
+    T allreduce(const T& value, const F& fn) {
+        return allreduce<T>(value, mpi_lambda_op<T, F>::get(fn));
+    }
+
+    /**
+     * Combines vectors from every process element by element and gives the
+     * result to all of them. Every process must pass the same number of
+     * values.
+     * 
+     * @param values This process's contribution.
+     * @param op The operation to combine values with, such as MPI_SUM.
+     * @param T The MPI-supported type to reduce.
+     * 
+     * @return The combined values.
+     */
+    template<typename T>
+    std::vector<T> allreduceMultiple(const std::vector<T>& values, MPI_Op op) {
+        std::vector<T> result(values.size());
+        double start = profileStart();
+        MPI_Allreduce(values.data(), result.data(), values.size(), mpi_type<T>::get(), op, this->world);
+        profileTime(PROFILE_COLLECTIVE, start);
+        return result;
+    }
+
+    /**
+     * Combines vectors from every process element by element using a
+     * function and gives the result to all of them.
+     * 
+     * @param values This process's contribution.
+     * @param fn The function to combine values with, as T(const T&, const T&).
+     * @param T The MPI-supported type to reduce.
+     * 
+     * @return The combined values.
+     */
+    template<typename T, typename F>
+    std::vector<T> allreduceMultiple(const std::vector<T>& values, const F& fn) {
+        return allreduceMultiple<T>(values, mpi_lambda_op<T, F>::get(fn));
+    }
+
+    /**
+     * Combines vectors from every process element by element in two
+     * levels: within each node first, then across one leader per node, and
+     * back out within each node. Only one message per node crosses the
+     * network instead of one per process. Must be called on every process.
+     * 
+     * @param values This process's contribution.
+     * @param op The operation to combine values with, such as MPI_SUM. Must
+     * be commutative.
+     * @param T The MPI-supported type to reduce.
+     * 
+     * @return The combined values.
+     */
+    template<typename T>
+    std::vector<T> allreduceHierarchical(const std::vector<T>& values, MPI_Op op) {
+        MPIWrapper& local = getNode();
+        MPIWrapper& across = getLeaders();
+        std::vector<T> result = local.reduceMultiple<T>(values, op, 0);
+        if (local.getRank() == 0) {
+            result = across.allreduceMultiple<T>(result, op);
+        }
+        local.broadcastMultiple<T>(result, 0);
+        return result;
+    }
+
+    /**
+     * Combines vectors from every process element by element using a
+     * function, within each node first and then across nodes.
+     * 
+     * @param values This process's contribution.
+     * @param fn The function to combine values with, as T(const T&, const T&).
+     * Must be associative and commutative.
+     * @param T The MPI-supported type to reduce.
+     * 
+     * @return The combined values.
+     */
+    template<typename T, typename F>
+    std::vector<T> allreduceHierarchical(const std::vector<T>& values, const F& fn) {
+        return allreduceHierarchical<T>(values, mpi_lambda_op<T, F>::get(fn));
+    }
+
+    /**
+     * Combines a value from every process, within each node first and then
+     * across nodes.
+     * 
+     * @param value This process's contribution.
+     * @param op The operation to combine values with, such as MPI_SUM.
+     * @param T The MPI-supported type to reduce.
+     * 
+     * @return The combined value.
+     */
+    template<typename T>
+    T allreduceHierarchical(const T& value, MPI_Op op) {
+        return allreduceHierarchical<T>(std::vector<T>(1, value), op)[0];
+    }
+
+    /**
+     * Combines a value from every process using a function, within each
+     * node first and then across nodes.
+     * 
+     * @param value This process's contribution.
+     * @param fn The function to combine values with, as T(const T&, const T&).
+     * Must be associative and commutative.
+     * @param T The MPI-supported type to reduce.
+     * 
+     * @return The combined value.
+     */
+    template<typename T, typename F>
+    T allreduceHierarchical(const T& value, const F& fn) {
+        return allreduceHierarchical<T>(value, mpi_lambda_op<T, F>::get(fn));
+    }
+
+    /**
+     * Sends a vector from the root to every process, across node leaders
+     * first and then within each node.
+     * 
+     * @param values The values to send on the root, and the vector to fill
+     * everywhere else.
+     * @param root The rank to broadcast from. Defaults to 0.
+     * @param T The MPI-supported type to broadcast.
+     */
+    template<typename T>
+    void broadcastHierarchical(std::vector<T>& values, const int& root=0) {
+        MPIWrapper& local = getNode();
+        MPIWrapper& across = getLeaders();
+        if (root != 0) {
+            // Hand the data to rank 0, which leads the first node.
+            if (getRank() == root) {
+                sendMultiple<T>(values, 0, HIERARCHY_TAG);
+            } else if (getRank() == 0) {
+                receiveMultiple<T>(values, root, HIERARCHY_TAG);
+            }
+        }
+        if (local.getRank() == 0) {
+            across.broadcastMultiple<T>(values, 0);
+        }
+        local.broadcastMultiple<T>(values, 0);
+    }
+
+    /**
+     * Allocates a segment of memory shared with every process on this
+     * process's node, which they can read and write directly instead of
+     * sending copies. Must be called on every process.
+     * 
+     * @param count The number of values in this process's segment. May
+     * differ between processes, and may be 0.
+     * @param T The trivially copyable type of the values.
+     * 
+     * @return The shared array. Find a neighbor's segment with at(rank),
+     * using node ranks (getNode().getRank()).
+     */
+    template<typename T>
+    MPISharedArray<T> allocateShared(const long& count) {
+        MPIWrapper& local = getNode();
+        double start = profileStart();
+        MPISharedArray<T> result(local.getComm(), count);
+        profileTime(PROFILE_COLLECTIVE, start);
+        return result;
+    }
+
+    /**
+     * Shares a read-only table with every process, storing it once per node
+     * rather than once per process. The node leaders hold the memory and
+     * the table is broadcast among them only; the other processes read it
+     * in place. Must be called on every process.
+     * 
+     * @param values The table on the root. Ignored elsewhere.
+     * @param root The rank holding the table. Defaults to 0.
+     * @param T The MPI-supported type of the values.
+     * 
+     * @return The shared array. Read the table through at(0), which is the
+     * same memory for every process of a node.
+     */
+    template<typename T>
+    MPISharedArray<T> shareTable(const std::vector<T>& values, const int& root=0) {
+        MPIWrapper& local = getNode();
+        MPIWrapper& across = getLeaders();
+        long count = values.size();
+        broadcast<long>(count, root);
+        MPISharedArray<T> table = allocateShared<T>(local.getRank() == 0 ? count : 0);
+        T* shared = table.at(0);
+
+        // The root fills its own node's copy, and that node's leader is the
+        // source for the others.
+        bool hasRoot = local.allreduce<int>(getRank() == root, MPI_LOR);
+        int source = allreduce<int>(hasRoot && local.getRank() == 0 ? across.getRank() : -1, MPI_MAX);
+        if (getRank() == root) {
+            std::copy(values.begin(), values.end(), shared);
+        }
+        table.barrier();
+        if (local.getRank() == 0 && across.getSize() > 1) {
+            double start = profileStart();
+            for (long first = 0; first < count; first += INT_MAX) {
+                int length = std::min<long>(count - first, INT_MAX);
+                MPI_Bcast(shared + first, length, mpi_type<T>::get(), source, across.getComm());
+            }
+            profileTime(PROFILE_COLLECTIVE, start);
+        }
+        table.barrier();
+        return table;
+    }
+
+    /**
+     * Allocates a window of values on every process that the others can
+     * put, get and accumulate into one-sidedly, for irregular updates that
+     * would otherwise need a matched receive on the target. Must be called
+     * on every process.
+     * 
+     * @param count The number of values on this process. May differ between
+     * processes.
+     * @param T The MPI-supported type of the values.
+     * 
+     * @return The window, with no epoch open.
+     */
+    template<typename T>
+    MPIWindow<T> createWindow(const long& count) {
+        double start = profileStart();
+        MPIWindow<T> result(this->world, count);
+        profileTime(PROFILE_COLLECTIVE, start);
+        return result;
+    }
+
+    /**
+     * Combines the values of this process and every lower rank.
+     * 
+     * @param value This process's contribution.
+     * @param op The operation to combine values with, such as MPI_SUM.
+     * @param T The MPI-supported type to scan.
+     * 
+     * @return The combined value of ranks 0 through this one.
+     */
+    template<typename T>
+    T scan(const T& value, MPI_Op op) {
+        T result;
+        double start = profileStart();
+        MPI_Scan(&value, &result, 1, mpi_type<T>::get(), op, this->world);
+        profileTime(PROFILE_COLLECTIVE, start);
+        return result;
+    }
+
+    /**
+     * Combines the values of this process and every lower rank using a
+     * function.
+     * 
+     * @param value This process's contribution.
+     * @param fn The function to combine values with, as T(const T&, const T&).
+     * @param T The MPI-supported type to scan.
+     * 
+     * @return The combined value of ranks 0 through this one.
+     */
+    template<typename T, typename F>
+    T scan(const T& value, const F& fn) {
+        return scan<T>(value, mpi_lambda_op<T, F>::get(fn));
+    }
+
+    /**
+     * Combines the values of every lower rank, excluding this one.
+     * 
+     * @param value This process's contribution.
+     * @param op The operation to combine values with, such as MPI_SUM.
+     * @param init The result on rank 0, which has no lower ranks.
+     * @param T The MPI-supported type to scan.
+     * 
+     * @return The combined value of ranks 0 through the one before this.
+     */
+    template<typename T>
+    T exscan(const T& value, MPI_Op op, const T& init=T()) {
+        T result = init;
+        double start = profileStart();
+        MPI_Exscan(&value, &result, 1, mpi_type<T>::get(), op, this->world);
+        profileTime(PROFILE_COLLECTIVE, start);
+        return getRank() == 0 ? init : result;
+    }
+
+    /**
+     * Collects a value from every process into the root.
+     * 
+     * @param value This process's contribution.
+     * @param root The rank to collect on. Defaults to 0.
+     * @param T The MPI-supported type to gather.
+     * 
+     * @return The values in rank order on the root. Empty elsewhere.
+     */
+    template<typename T>
+    std::vector<T> gather(const T& value, const int& root=0) {
+        std::vector<T> result(getRank() == root ? getSize() : 0);
+        double start = profileStart();
+        MPI_Gather(&value, 1, mpi_type<T>::get(), result.data(), 1, mpi_type<T>::get(), root, this->world);
+        profileTime(PROFILE_COLLECTIVE, start);
+        return result;
+    }
+
+    /**
+     * Collects a vector from every process into the root. Vectors may differ
+     * in length.
+     * 
+     * @param values This process's contribution.
+     * @param root The rank to collect on. Defaults to 0.
+     * @param T The MPI-supported type to gather.
+     * 
+     * @return The values concatenated in rank order on the root. Empty
+     * elsewhere.
+     */
+    template<typename T>
+    std::vector<T> gatherMultiple(const std::vector<T>& values, const int& root=0) {
+        std::vector<int> counts = gather<int>(values.size(), root);
+        std::vector<int> offsets = displacementsOf(counts);
+        std::vector<T> result(getRank() == root ? offsets.back() + counts.back() : 0);
+        double start = profileStart();
+        MPI_Gatherv(values.data(), values.size(), mpi_type<T>::get(), result.data(), counts.data(),
+            offsets.data(), mpi_type<T>::get(), root, this->world);
+        profileTime(PROFILE_COLLECTIVE, start);
+        return result;
+    }
+
+    /**
+     * Collects a value from every process into every process.
+     * 
+     * @param value This process's contribution.
+     * @param T The MPI-supported type to gather.
+     * 
+     * @return The values in rank order.
+     */
+    template<typename T>
+    std::vector<T> allgather(const T& value) {
+        std::vector<T> result(getSize());
+        double start = profileStart();
+        MPI_Allgather(&value, 1, mpi_type<T>::get(), result.data(), 1, mpi_type<T>::get(), this->world);
+        profileTime(PROFILE_COLLECTIVE, start);
+        return result;
+    }
+
+    /**
+     * Collects a vector from every process into every process. Vectors may
+     * differ in length.
+     * 
+     * @param values This process's contribution.
+     * @param T The MPI-supported type to gather.
+     * 
+     * @return The values concatenated in rank order.
+     */
+    template<typename T>
+    std::vector<T> allgatherMultiple(const std::vector<T>& values) {
+        std::vector<int> counts = allgather<int>(values.size());
+        std::vector<int> offsets = displacementsOf(counts);
+        std::vector<T> result(offsets.back() + counts.back());
+        double start = profileStart();
+        MPI_Allgatherv(values.data(), values.size(), mpi_type<T>::get(), result.data(), counts.data(),
+            offsets.data(), mpi_type<T>::get(), this->world);
+        profileTime(PROFILE_COLLECTIVE, start);
+        return result;
+    }
+
+    /**
+     * Hands one value to each process from the root.
+     * 
+     * @param values One value per rank, in rank order. Only read on the root.
+     * @param root The rank to scatter from. Defaults to 0.
+     * @param T The MPI-supported type to scatter.
+     * 
+     * @return This process's value.
+     */
+    template<typename T>
+    T scatter(const std::vector<T>& values, const int& root=0) {
+        T result;
+        double start = profileStart();
+        MPI_Scatter(values.data(), 1, mpi_type<T>::get(), &result, 1, mpi_type<T>::get(), root, this->world);
+        profileTime(PROFILE_COLLECTIVE, start);
+        return result;
+    }
+
+    /**
+     * Splits a vector on the root into contiguous blocks, one per process.
+     * When the length does not divide evenly, lower ranks get one extra.
+     * 
+     * @param values The values to split. Only read on the root.
+     * @param root The rank to scatter from. Defaults to 0.
+     * @param T The MPI-supported type to scatter.
+     * 
+     * @return This process's block.
+     */
+    template<typename T>
+    std::vector<T> scatterMultiple(const std::vector<T>& values, const int& root=0) {
+        int total = values.size();
+        double start = profileStart();
+        MPI_Bcast(&total, 1, MPI_INT, root, this->world);
+        profileTime(PROFILE_COLLECTIVE, start);
+        std::vector<int> counts = blockCounts(total);
+        std::vector<int> offsets = displacementsOf(counts);
+        std::vector<T> result(counts[getRank()]);
+        start = profileStart();
+        MPI_Scatterv(values.data(), counts.data(), offsets.data(), mpi_type<T>::get(), result.data(),
+            result.size(), mpi_type<T>::get(), root, this->world);
+        profileTime(PROFILE_COLLECTIVE, start);
+        return result;
+    }
+
+    /**
+     * Sends one value to every process and receives one from each.
+     * 
+     * @param values The value for each rank, in rank order.
+     * @param T The MPI-supported type to exchange.
+     * 
+     * @return The value from each rank, in rank order.
+     */
+    template<typename T>
+    std::vector<T> alltoall(const std::vector<T>& values) {
+        std::vector<T> result(getSize());
+        double start = profileStart();
+        MPI_Alltoall(values.data(), 1, mpi_type<T>::get(), result.data(), 1, mpi_type<T>::get(), this->world);
+        profileTime(PROFILE_COLLECTIVE, start);
+        return result;
+    }
+
+    /**
+     * Sends a vector to every process and receives one from each. Vectors
+     * may differ in length.
+     * 
+     * @param values The values for each rank, in rank order.
+     * @param T The MPI-supported type to exchange.
+     * 
+     * @return The values from each rank, in rank order.
+     */
+    template<typename T>
+    std::vector<std::vector<T>> alltoallMultiple(const std::vector<std::vector<T>>& values) {
+        std::vector<int> sendCounts(getSize());
+        std::vector<T> outgoing;
+        for (int i = 0; i < getSize(); i++) {
+            sendCounts[i] = values[i].size();
+            outgoing.insert(outgoing.end(), values[i].begin(), values[i].end());
+        }
+        std::vector<int> recvCounts = alltoall<int>(sendCounts);
+        std::vector<int> sendOffsets = displacementsOf(sendCounts);
+        std::vector<int> recvOffsets = displacementsOf(recvCounts);
+        std::vector<T> incoming(recvOffsets.back() + recvCounts.back());
+        double start = profileStart();
+        MPI_Alltoallv(outgoing.data(), sendCounts.data(), sendOffsets.data(), mpi_type<T>::get(),
+            incoming.data(), recvCounts.data(), recvOffsets.data(), mpi_type<T>::get(), this->world);
+        profileTime(PROFILE_COLLECTIVE, start);
+        std::vector<std::vector<T>> result(getSize());
+        for (int i = 0; i < getSize(); i++) {
+            result[i].assign(incoming.begin() + recvOffsets[i], incoming.begin() + recvOffsets[i] + recvCounts[i]);
+        }
+        return result;
+    }
+
+    /**
+     * Writes every process's values to one shared file, in rank order, with
+     * a collective MPI-IO write. Each process writes its own part directly,
+     * so nothing is funneled through one rank. The file holds the raw values
+     * in the machine's native layout, and is truncated to fit them.
+     * 
+     * @param path The file to write. Created if it does not exist.
+     * @param values This process's block.
+     * @param count The number of values in the block.
+     * @param T The MPI-supported type to write.
+     * 
+     * @throws std::runtime_error If the file could not be opened, or a
+     * block holds more than INT_MAX values.
+     */
+    template<typename T>
+    void writeBlocks(const std::string& path, const T* values, const long& count) {
+        MPI_Offset total;
+        MPI_Offset offset = blockOffset(count, total);
+        MPI_File file = mpi_file_open(this->world, path, MPI_MODE_CREATE | MPI_MODE_WRONLY, mpi_type<T>::get());
+        double start = profileStart();
+        MPI_File_set_size(file, total * mpi_file_extent(mpi_type<T>::get()));
+        MPI_File_write_at_all(file, offset, values, count, mpi_type<T>::get(), MPI_STATUS_IGNORE);
+        profileTime(PROFILE_COLLECTIVE, start);
+        MPI_File_close(&file);
+    }
+
+    /**
+     * Writes every process's values to one shared file, in rank order.
+     * 
+     * @param path The file to write. Created if it does not exist.
+     * @param values This process's block.
+     * @param T The MPI-supported type to write.
+     * 
+     * @throws std::runtime_error If the file could not be opened, or a
+     * block holds more than INT_MAX values.
+     */
+    template<typename T>
+    void writeBlocks(const std::string& path, const std::vector<T>& values) {
+        writeBlocks<T>(path, values.data(), values.size());
+    }
+
+    /**
+     * Reads this process's block of a shared file with a collective MPI-IO
+     * read, where each process's block is as long as the vector passed in.
+     * Restores what writeBlocks wrote when the same processes pass blocks of
+     * the same sizes.
+     * 
+     * @param path The file to read.
+     * @param values Sized to the block to read, and filled with it.
+     * @param T The MPI-supported type to read.
+     * 
+     * @throws std::runtime_error If the file could not be opened, or a
+     * block holds more than INT_MAX values.
+     */
+    template<typename T>
+    void readBlocks(const std::string& path, std::vector<T>& values) {
+        MPI_Offset total;
+        MPI_Offset offset = blockOffset(values.size(), total);
+        MPI_File file = mpi_file_open(this->world, path, MPI_MODE_RDONLY, mpi_type<T>::get());
+        double start = profileStart();
+        MPI_File_read_at_all(file, offset, values.data(), values.size(), mpi_type<T>::get(), MPI_STATUS_IGNORE);
+        profileTime(PROFILE_COLLECTIVE, start);
+        MPI_File_close(&file);
+    }
+
+    /**
+     * Reads a shared file split into even blocks, one per process, with
+     * lower ranks taking the remainder as in scatterMultiple. Works for any
+     * number of processes, whatever wrote the file.
+     * 
+     * @param path The file to read.
+     * @param T The MPI-supported type to read.
+     * 
+     * @return This process's block.
+     * 
+     * @throws std::runtime_error If the file could not be opened, or a
+     * block would hold more than INT_MAX values.
+     */
+    template<typename T>
+    std::vector<T> readBlocks(const std::string& path) {
+        MPI_File file = mpi_file_open(this->world, path, MPI_MODE_RDONLY, mpi_type<T>::get());
+        MPI_Offset bytes;
+        MPI_Offset offset;
+        MPI_File_get_size(file, &bytes);
+        int count;
+        try {
+            count = fileBlock(bytes / mpi_file_extent(mpi_type<T>::get()), offset);
+        } catch (...) {
+            MPI_File_close(&file);
+            throw;
+        }
+        std::vector<T> values(count);
+        double start = profileStart();
+        MPI_File_read_at_all(file, offset, values.data(), values.size(),
+            mpi_type<T>::get(), MPI_STATUS_IGNORE);
+        profileTime(PROFILE_COLLECTIVE, start);
+        MPI_File_close(&file);
+        return values;
+    }
+
+    /**
+     * Starts writing every process's values to one shared file with a
+     * split-collective write, so that computation can continue while the
+     * data goes out. The values are copied, so the vector may change
+     * straight away.
+     * 
+     * @param path The file to write. Created if it does not exist.
+     * @param values This process's block.
+     * @param T The MPI-supported type to write.
+     * 
+     * @return The transfer, to finish() on every process.
+     * 
+     * @throws std::runtime_error If the file could not be opened, or a
+     * block holds more than INT_MAX values.
+     */
+    template<typename T>
+    MPIFileTransfer<T> startWriteBlocks(const std::string& path, const std::vector<T>& values) {
+        MPI_Offset total;
+        MPI_Offset offset = blockOffset(values.size(), total);
+        MPI_File file = mpi_file_open(this->world, path, MPI_MODE_CREATE | MPI_MODE_WRONLY, mpi_type<T>::get());
+        MPI_File_set_size(file, total * mpi_file_extent(mpi_type<T>::get()));
+        return MPIFileTransfer<T>(file, std::vector<T>(values), offset, false);
+    }
+
+    /**
+     * Starts reading this process's block of a shared file with a
+     * split-collective read. Blocks are as in readBlocks(path).
+     * 
+     * @param path The file to read.
+     * @param T The MPI-supported type to read.
+     * 
+     * @return The transfer, whose finish() returns the block.
+     * 
+     * @throws std::runtime_error If the file could not be opened, or a
+     * block would hold more than INT_MAX values.
      */
     template<typename T>
-    T* receiveMultipleTagged(const int& count, const int& tag) {
-        return receiveMultiple<T>(count, MPI_ANY_SOURCE, tag, lastStatus);
+    MPIFileTransfer<T> startReadBlocks(const std::string& path) {
+        MPI_File file = mpi_file_open(this->world, path, MPI_MODE_RDONLY, mpi_type<T>::get());
+        MPI_Offset bytes;
+        MPI_Offset offset;
+        MPI_File_get_size(file, &bytes);
+        int count;
+        try {
+            count = fileBlock(bytes / mpi_file_extent(mpi_type<T>::get()), offset);
+        } catch (...) {
+            MPI_File_close(&file);
+            throw;
+        }
+        return MPIFileTransfer<T>(file, std::vector<T>(count), offset, true);
     }
 
     /**
@@ -380,11 +1984,13 @@ public:
 
     /**
      * Sets the work function. The wrapper will continue executing this
-     * function until it returns true.
+     * function until it returns true. The wrapper is passed by reference;
+     * functions that take it by value still work, but pay for a copy on
+     * every iteration. See MPIIterator for convergence-driven loops.
      * 
      * @param work_fn The work function to set.
      */
-    void setWorkFunction(std::function<bool (MPIWrapper)> work_fn);
+    void setWorkFunction(std::function<bool (MPIWrapper&)> work_fn);
 
     /**
      * Runs the work function, if it exists.